@@ -0,0 +1,254 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FramePipeline.h"
+
+namespace FrameUtil
+{
+
+// Converts whole dumps on all cores. The workers share nothing but the job: each one owns a copy of the pipeline and
+// a scratch buffer, and every frame is written to its own slot, so the output doesn't depend on the scheduling or on
+// the number of threads.
+//
+// Work is handed out as index ranges, one contiguous range per worker to start with. A worker takes small chunks from
+// the front of its own range and, once that is empty, steals the back half of the largest range left. Consecutive
+// frames mostly stay on one worker, which keeps its pipeline cache useful.
+class FrameBatch
+{
+ public:
+  // 0 starts one thread per hardware thread. The calling thread is one of them.
+  explicit FrameBatch(int numThreads = 0);
+  ~FrameBatch();
+
+  FrameBatch(const FrameBatch&) = delete;
+  FrameBatch& operator=(const FrameBatch&) = delete;
+
+  int GetNumThreads() const { return (int)m_workers.size(); }
+
+  // Converts count frames the way pipeline is configured. Frame i is read from pSrcFrames + i * srcStride and written
+  // to pDestFrames + i * destStride, a stride of 0 means the size of one source or target frame. Returns false if the
+  // pipeline is not valid.
+  bool Convert(const FramePipeline& pipeline, const uint8_t* pSrcFrames, uint8_t* pDestFrames, size_t count,
+               size_t srcStride = 0, size_t destStride = 0);
+
+  // Calls task(index, worker) for every index below count and returns once all are done. A worker never runs two
+  // tasks at once, so worker can pick per-thread state like GetScratch(). Tasks must not throw or call Run() again.
+  void Run(size_t count, const std::function<void(size_t index, int worker)>& task);
+
+  // Scratch memory of a worker, valid until the next call for the same worker.
+  uint8_t* GetScratch(int worker, size_t size);
+
+ private:
+  struct Worker
+  {
+    std::mutex mutex;
+    size_t next = 0;
+    size_t end = 0;
+    std::vector<uint8_t> scratch;
+    FramePipeline pipeline;
+  };
+
+  void ThreadMain(int worker);
+  void Work(int worker);
+  bool Take(int worker, size_t& begin, size_t& end);
+  bool Steal(int worker);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+  const std::function<void(size_t, int)>* m_pTask = nullptr;
+  size_t m_grain = 1;
+
+  std::mutex m_mutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  int m_busy = 0;
+  bool m_quit = false;
+};
+
+inline FrameBatch::FrameBatch(int numThreads)
+{
+  if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+  if (numThreads <= 0) numThreads = 1;
+
+  for (int i = 0; i < numThreads; i++)
+  {
+    m_workers.emplace_back(new Worker());
+  }
+  for (int i = 1; i < numThreads; i++)
+  {
+    m_threads.emplace_back(&FrameBatch::ThreadMain, this, i);
+  }
+}
+
+inline FrameBatch::~FrameBatch()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+  }
+  m_start.notify_all();
+  for (std::thread& thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+inline bool FrameBatch::Convert(const FramePipeline& pipeline, const uint8_t* pSrcFrames, uint8_t* pDestFrames,
+                                size_t count, size_t srcStride, size_t destStride)
+{
+  if (!pipeline.IsValid()) return false;
+  if (srcStride == 0) srcStride = pipeline.GetSourceSize();
+  if (destStride == 0) destStride = pipeline.GetTargetSize();
+
+  // Workers keep their buffers and panel layout from the previous batch if the configuration still fits.
+  for (auto& pWorker : m_workers)
+  {
+    pWorker->pipeline = pipeline;
+  }
+
+  Run(count,
+      [&](size_t index, int worker)
+      { m_workers[worker]->pipeline.Process(&pSrcFrames[index * srcStride], &pDestFrames[index * destStride]); });
+  return true;
+}
+
+inline void FrameBatch::Run(size_t count, const std::function<void(size_t index, int worker)>& task)
+{
+  if (count == 0) return;
+
+  size_t numWorkers = m_workers.size();
+  // Small enough chunks to balance, large enough to keep the owner's mutex out of the way.
+  m_grain = count / (numWorkers * 16);
+  if (m_grain < 1) m_grain = 1;
+  if (m_grain > 64) m_grain = 64;
+  m_pTask = &task;
+
+  for (size_t i = 0; i < numWorkers; i++)
+  {
+    std::lock_guard<std::mutex> lock(m_workers[i]->mutex);
+    m_workers[i]->next = count * i / numWorkers;
+    m_workers[i]->end = count * (i + 1) / numWorkers;
+  }
+
+  if (numWorkers > 1)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_busy = (int)numWorkers - 1;
+      m_generation++;
+    }
+    m_start.notify_all();
+  }
+
+  Work(0);
+
+  if (numWorkers > 1)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+  }
+  m_pTask = nullptr;
+}
+
+inline uint8_t* FrameBatch::GetScratch(int worker, size_t size)
+{
+  std::vector<uint8_t>& scratch = m_workers[worker]->scratch;
+  if (scratch.size() < size) scratch.resize(size);
+  return scratch.data();
+}
+
+inline void FrameBatch::ThreadMain(int worker)
+{
+  uint64_t generation = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock, [&]() { return m_quit || m_generation != generation; });
+      if (m_quit) return;
+      generation = m_generation;
+    }
+
+    Work(worker);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_busy == 0) m_done.notify_one();
+  }
+}
+
+inline void FrameBatch::Work(int worker)
+{
+  size_t begin;
+  size_t end;
+  do
+  {
+    while (Take(worker, begin, end))
+    {
+      for (size_t index = begin; index < end; index++)
+      {
+        (*m_pTask)(index, worker);
+      }
+    }
+  } while (Steal(worker));
+}
+
+inline bool FrameBatch::Take(int worker, size_t& begin, size_t& end)
+{
+  Worker& self = *m_workers[worker];
+  std::lock_guard<std::mutex> lock(self.mutex);
+
+  if (self.next >= self.end) return false;
+  begin = self.next;
+  end = self.end - self.next > m_grain ? self.next + m_grain : self.end;
+  self.next = end;
+  return true;
+}
+
+inline bool FrameBatch::Steal(int worker)
+{
+  for (;;)
+  {
+    int victim = -1;
+    size_t largest = 0;
+    for (int i = 0; i < (int)m_workers.size(); i++)
+    {
+      if (i == worker) continue;
+      std::lock_guard<std::mutex> lock(m_workers[i]->mutex);
+      if (m_workers[i]->end - m_workers[i]->next > largest)
+      {
+        largest = m_workers[i]->end - m_workers[i]->next;
+        victim = i;
+      }
+    }
+    if (victim < 0) return false;
+
+    size_t begin;
+    size_t end;
+    {
+      Worker& other = *m_workers[victim];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      size_t remaining = other.end - other.next;
+      // Someone else got there first, look again.
+      if (remaining == 0) continue;
+      end = other.end;
+      begin = other.end - (remaining > 1 ? remaining / 2 : 1);
+      other.end = begin;
+    }
+
+    // Ranges only shrink once handed out, so nobody can have stolen from the empty own range in between.
+    Worker& self = *m_workers[worker];
+    std::lock_guard<std::mutex> lock(self.mutex);
+    self.next = begin;
+    self.end = end;
+    return true;
+  }
+}
+
+}  // namespace FrameUtil
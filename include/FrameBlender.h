@@ -0,0 +1,315 @@
+#pragma once
+
+#include <vector>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+enum class BlendMode
+{
+  Average,  // mean of the window, in as many shades as it can produce
+  Majority  // every bit plane shows what it showed in at least half of the window
+};
+
+// Merges the frames some ROMs alternate quickly to fake extra shades, so LED panels show steady shades instead of the
+// flicker. The blender keeps the last `window` indexed frames in a ring together with running per-pixel sums, so
+// every new frame costs one pass that adds it and drops the oldest one, no matter how long the window is.
+//
+// Average maps the sum over the window to an indexed frame of GetOutputBitlen() bits, by default just enough to tell
+// every possible sum apart. Majority keeps the input depth and rejects short blinks instead: each bit plane votes on
+// its own, which is how the ROMs modulate them.
+class FrameBlender
+{
+ public:
+  static constexpr int MaxWindow = 16;
+
+  // Pixels are indexed with bitlen significant bits, higher bits are ignored. The window holds 1 to MaxWindow frames.
+  // outBitlen only applies to Average, 0 picks the smallest depth that keeps every sum apart.
+  FrameBlender(uint16_t width, uint16_t height, uint8_t bitlen, int window, BlendMode mode = BlendMode::Average,
+               uint8_t outBitlen = 0);
+
+  int GetWindow() const { return m_window; }
+  BlendMode GetMode() const { return m_mode; }
+  uint8_t GetOutputBitlen() const { return m_outBitlen; }
+
+  // Adds a frame and writes the blended one, width * height indexed pixels. The first frame after construction or
+  // Reset() fills the whole window, so the output never fades in.
+  void Process(const uint8_t* pFrame, uint8_t* pDest);
+  // Same for bit planes as written by Helper::Split() with the bitlen of the blender.
+  void ProcessPlanes(const uint8_t* pPlanes, uint8_t* pDest);
+  void Reset() { m_valid = false; }
+
+ private:
+  void Prime(const uint8_t* pFrame);
+
+  uint16_t m_width;
+  uint16_t m_height;
+  int m_size;
+  uint8_t m_bitlen;
+  uint8_t m_mask;
+  int m_window;
+  BlendMode m_mode;
+  uint8_t m_outBitlen;
+
+  bool m_valid = false;
+  int m_next = 0;
+  std::vector<uint8_t> m_ring;
+  // Average: sum per pixel and the shade of every possible sum. Majority: lit count per plane and pixel.
+  std::vector<uint16_t> m_sums;
+  std::vector<uint8_t> m_shades;
+  std::vector<uint8_t> m_counts;
+  std::vector<uint8_t> m_joined;
+};
+
+namespace Detail
+{
+
+// Replaces the oldest frame of the window in pSlot with pFrame and moves the sums of n pixels along.
+inline void AccumulateFrame(uint16_t* pSums, uint8_t* pSlot, const uint8_t* pFrame, uint8_t mask, int n)
+{
+  int i = 0;
+
+#if defined(FRAMEUTIL_AVX2)
+  const __m256i avx2Mask = _mm256_set1_epi8((char)mask);
+  for (; i + 32 <= n; i += 32)
+  {
+    __m256i added = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&pFrame[i]), avx2Mask);
+    __m256i removed = _mm256_loadu_si256((const __m256i*)&pSlot[i]);
+    _mm256_storeu_si256((__m256i*)&pSlot[i], added);
+    for (int half = 0; half < 2; half++)
+    {
+      __m128i addedHalf = half == 0 ? _mm256_castsi256_si128(added) : _mm256_extracti128_si256(added, 1);
+      __m128i removedHalf = half == 0 ? _mm256_castsi256_si128(removed) : _mm256_extracti128_si256(removed, 1);
+      __m256i* pSum = (__m256i*)&pSums[i + half * 16];
+      __m256i sums = _mm256_add_epi16(_mm256_loadu_si256(pSum), _mm256_cvtepu8_epi16(addedHalf));
+      _mm256_storeu_si256(pSum, _mm256_sub_epi16(sums, _mm256_cvtepu8_epi16(removedHalf)));
+    }
+  }
+#endif
+
+#if defined(FRAMEUTIL_SSE2)
+  const __m128i sse2Mask = _mm_set1_epi8((char)mask);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16)
+  {
+    __m128i added = _mm_and_si128(_mm_loadu_si128((const __m128i*)&pFrame[i]), sse2Mask);
+    __m128i removed = _mm_loadu_si128((const __m128i*)&pSlot[i]);
+    _mm_storeu_si128((__m128i*)&pSlot[i], added);
+    __m128i low = _mm_loadu_si128((const __m128i*)&pSums[i]);
+    __m128i high = _mm_loadu_si128((const __m128i*)&pSums[i + 8]);
+    low = _mm_sub_epi16(_mm_add_epi16(low, _mm_unpacklo_epi8(added, zero)), _mm_unpacklo_epi8(removed, zero));
+    high = _mm_sub_epi16(_mm_add_epi16(high, _mm_unpackhi_epi8(added, zero)), _mm_unpackhi_epi8(removed, zero));
+    _mm_storeu_si128((__m128i*)&pSums[i], low);
+    _mm_storeu_si128((__m128i*)&pSums[i + 8], high);
+  }
+#elif defined(FRAMEUTIL_NEON)
+  const uint8x16_t neonMask = vdupq_n_u8(mask);
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16_t added = vandq_u8(vld1q_u8(&pFrame[i]), neonMask);
+    uint8x16_t removed = vld1q_u8(&pSlot[i]);
+    vst1q_u8(&pSlot[i], added);
+    uint16x8_t low = vsubw_u8(vaddw_u8(vld1q_u16(&pSums[i]), vget_low_u8(added)), vget_low_u8(removed));
+    uint16x8_t high = vsubw_u8(vaddw_u8(vld1q_u16(&pSums[i + 8]), vget_high_u8(added)), vget_high_u8(removed));
+    vst1q_u16(&pSums[i], low);
+    vst1q_u16(&pSums[i + 8], high);
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    uint8_t added = pFrame[i] & mask;
+    pSums[i] = (uint16_t)(pSums[i] + added - pSlot[i]);
+    pSlot[i] = added;
+  }
+}
+
+// Same for the lit counts of every plane, planes of n counts each, and writes the vote of n pixels to pDest. A pixel
+// keeps a plane lit while its count reaches half.
+inline void VoteFrame(uint8_t* pCounts, uint8_t* pSlot, const uint8_t* pFrame, uint8_t* pDest, int bitlen, int half,
+                      int n)
+{
+  const uint8_t mask = (uint8_t)((1 << bitlen) - 1);
+  int i = 0;
+
+#if defined(FRAMEUTIL_AVX2)
+  const __m256i avx2Mask = _mm256_set1_epi8((char)mask);
+  const __m256i avx2One = _mm256_set1_epi8(1);
+  const __m256i avx2Half = _mm256_set1_epi8((char)half);
+  for (; i + 32 <= n; i += 32)
+  {
+    __m256i added = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&pFrame[i]), avx2Mask);
+    __m256i removed = _mm256_loadu_si256((const __m256i*)&pSlot[i]);
+    _mm256_storeu_si256((__m256i*)&pSlot[i], added);
+    __m256i vote = _mm256_setzero_si256();
+    for (int p = 0; p < bitlen; p++)
+    {
+      const __m128i shift = _mm_cvtsi32_si128(p);
+      __m256i* pCount = (__m256i*)&pCounts[p * n + i];
+      __m256i count = _mm256_loadu_si256(pCount);
+      count = _mm256_add_epi8(count, _mm256_and_si256(_mm256_srl_epi16(added, shift), avx2One));
+      count = _mm256_sub_epi8(count, _mm256_and_si256(_mm256_srl_epi16(removed, shift), avx2One));
+      _mm256_storeu_si256(pCount, count);
+      __m256i lit = _mm256_cmpeq_epi8(_mm256_max_epu8(count, avx2Half), count);
+      vote = _mm256_or_si256(vote, _mm256_and_si256(lit, _mm256_set1_epi8((char)(1 << p))));
+    }
+    _mm256_storeu_si256((__m256i*)&pDest[i], vote);
+  }
+#endif
+
+#if defined(FRAMEUTIL_SSE2)
+  const __m128i sse2Mask = _mm_set1_epi8((char)mask);
+  const __m128i sse2One = _mm_set1_epi8(1);
+  const __m128i sse2Half = _mm_set1_epi8((char)half);
+  for (; i + 16 <= n; i += 16)
+  {
+    __m128i added = _mm_and_si128(_mm_loadu_si128((const __m128i*)&pFrame[i]), sse2Mask);
+    __m128i removed = _mm_loadu_si128((const __m128i*)&pSlot[i]);
+    _mm_storeu_si128((__m128i*)&pSlot[i], added);
+    __m128i vote = _mm_setzero_si128();
+    for (int p = 0; p < bitlen; p++)
+    {
+      const __m128i shift = _mm_cvtsi32_si128(p);
+      __m128i* pCount = (__m128i*)&pCounts[p * n + i];
+      __m128i count = _mm_loadu_si128(pCount);
+      count = _mm_add_epi8(count, _mm_and_si128(_mm_srl_epi16(added, shift), sse2One));
+      count = _mm_sub_epi8(count, _mm_and_si128(_mm_srl_epi16(removed, shift), sse2One));
+      _mm_storeu_si128(pCount, count);
+      __m128i lit = _mm_cmpeq_epi8(_mm_max_epu8(count, sse2Half), count);
+      vote = _mm_or_si128(vote, _mm_and_si128(lit, _mm_set1_epi8((char)(1 << p))));
+    }
+    _mm_storeu_si128((__m128i*)&pDest[i], vote);
+  }
+#elif defined(FRAMEUTIL_NEON)
+  const uint8x16_t neonMask = vdupq_n_u8(mask);
+  const uint8x16_t neonOne = vdupq_n_u8(1);
+  const uint8x16_t neonHalf = vdupq_n_u8((uint8_t)half);
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16_t added = vandq_u8(vld1q_u8(&pFrame[i]), neonMask);
+    uint8x16_t removed = vld1q_u8(&pSlot[i]);
+    vst1q_u8(&pSlot[i], added);
+    uint8x16_t vote = vdupq_n_u8(0);
+    for (int p = 0; p < bitlen; p++)
+    {
+      const int8x16_t shift = vdupq_n_s8((int8_t)-p);
+      uint8x16_t count = vld1q_u8(&pCounts[p * n + i]);
+      count = vaddq_u8(count, vandq_u8(vshlq_u8(added, shift), neonOne));
+      count = vsubq_u8(count, vandq_u8(vshlq_u8(removed, shift), neonOne));
+      vst1q_u8(&pCounts[p * n + i], count);
+      vote = vorrq_u8(vote, vandq_u8(vcgeq_u8(count, neonHalf), vdupq_n_u8((uint8_t)(1 << p))));
+    }
+    vst1q_u8(&pDest[i], vote);
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    uint8_t added = pFrame[i] & mask;
+    uint8_t vote = 0;
+    for (int p = 0; p < bitlen; p++)
+    {
+      uint8_t& count = pCounts[p * n + i];
+      count = (uint8_t)(count + ((added >> p) & 1) - ((pSlot[i] >> p) & 1));
+      if (count >= half) vote |= (uint8_t)(1 << p);
+    }
+    pSlot[i] = added;
+    pDest[i] = vote;
+  }
+}
+
+}  // namespace Detail
+
+inline FrameBlender::FrameBlender(uint16_t width, uint16_t height, uint8_t bitlen, int window, BlendMode mode,
+                                  uint8_t outBitlen)
+    : m_width(width),
+      m_height(height),
+      m_size(width * height),
+      m_bitlen(bitlen < 1 ? 1 : (bitlen > 8 ? 8 : bitlen)),
+      m_mask((uint8_t)((1 << m_bitlen) - 1)),
+      m_window(window < 1 ? 1 : (window > MaxWindow ? MaxWindow : window)),
+      m_mode(mode)
+{
+  m_ring.resize((size_t)m_size * m_window);
+
+  if (m_mode == BlendMode::Majority)
+  {
+    m_outBitlen = m_bitlen;
+    m_counts.resize((size_t)m_size * m_bitlen);
+    return;
+  }
+
+  int maxSum = m_window * m_mask;
+  if (outBitlen == 0)
+  {
+    // Just enough shades for every sum.
+    outBitlen = 1;
+    while (outBitlen < 8 && (1 << outBitlen) <= maxSum) outBitlen++;
+  }
+  m_outBitlen = outBitlen > 8 ? 8 : outBitlen;
+
+  int maxShade = (1 << m_outBitlen) - 1;
+  m_sums.resize(m_size);
+  m_shades.resize(maxSum + 1);
+  for (int sum = 0; sum <= maxSum; sum++)
+  {
+    m_shades[sum] = (uint8_t)((sum * maxShade * 2 + maxSum) / (maxSum * 2));
+  }
+}
+
+inline void FrameBlender::Prime(const uint8_t* pFrame)
+{
+  for (int i = 0; i < m_size; i++)
+  {
+    uint8_t value = pFrame[i] & m_mask;
+    for (int slot = 0; slot < m_window; slot++)
+    {
+      m_ring[(size_t)slot * m_size + i] = value;
+    }
+    if (m_mode == BlendMode::Majority)
+    {
+      for (int p = 0; p < m_bitlen; p++)
+      {
+        m_counts[p * m_size + i] = (uint8_t)(((value >> p) & 1) * m_window);
+      }
+    }
+    else
+    {
+      m_sums[i] = (uint16_t)(value * m_window);
+    }
+  }
+  m_next = 0;
+  m_valid = true;
+}
+
+inline void FrameBlender::Process(const uint8_t* pFrame, uint8_t* pDest)
+{
+  if (!m_valid) Prime(pFrame);
+
+  uint8_t* pSlot = &m_ring[(size_t)m_next * m_size];
+  if (m_mode == BlendMode::Majority)
+  {
+    Detail::VoteFrame(m_counts.data(), pSlot, pFrame, pDest, m_bitlen, (m_window + 1) / 2, m_size);
+  }
+  else
+  {
+    Detail::AccumulateFrame(m_sums.data(), pSlot, pFrame, m_mask, m_size);
+    for (int i = 0; i < m_size; i++)
+    {
+      pDest[i] = m_shades[m_sums[i]];
+    }
+  }
+
+  m_next = m_next + 1 == m_window ? 0 : m_next + 1;
+}
+
+inline void FrameBlender::ProcessPlanes(const uint8_t* pPlanes, uint8_t* pDest)
+{
+  if (m_joined.empty()) m_joined.resize(m_size);
+  Helper::Join(m_joined.data(), m_width, m_height, m_bitlen, pPlanes);
+  Process(m_joined.data(), pDest);
+}
+
+}  // namespace FrameUtil
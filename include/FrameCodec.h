@@ -0,0 +1,361 @@
+#pragma once
+
+#include <vector>
+
+#include "FrameDiff.h"
+
+namespace FrameUtil
+{
+
+// Lossless frame codec for DMD content over slow serial or WiFi links. Encoder and decoder have to be created with the
+// same size, pixel size (1, 2 or 3 bytes) and zone size.
+//
+// Every frame starts with a flags byte. A keyframe carries all zones, any other frame a bitmap of the zones that
+// changed since the previous frame, followed by the changed zones in row-major order. Each zone starts with a mode
+// byte and its pixels in row-major order:
+//   ZoneRaw          the pixels as they are
+//   ZoneRle          runs of (count - 1, pixel), a run covers 1 to 256 pixels
+//   ZonePalette + n  (colors - 1, colors) followed by the pixel indices packed into n = 0, 1, 2 or 4 bits each, least
+//                    significant bits first
+class FrameCodec
+{
+ public:
+  static constexpr uint8_t Keyframe = 0x01;
+  static constexpr uint8_t ZoneRaw = 0x00;
+  static constexpr uint8_t ZoneRle = 0x01;
+  static constexpr uint8_t ZonePalette = 0x10;
+
+  FrameCodec(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth, int zoneHeight)
+      : m_width(width),
+        m_height(height),
+        m_bytesPerPixel(bytesPerPixel),
+        m_zoneWidth(zoneWidth),
+        m_zoneHeight(zoneHeight),
+        m_zoneColumns((width + zoneWidth - 1) / zoneWidth),
+        m_zoneRows((height + zoneHeight - 1) / zoneHeight)
+  {
+  }
+
+  int GetZoneCount() const { return m_zoneColumns * m_zoneRows; }
+  // Worst case size of one encoded frame.
+  size_t GetMaxEncodedSize() const
+  {
+    return 1 + (GetZoneCount() + 7) / 8 + GetZoneCount() + (size_t)m_width * m_height * m_bytesPerPixel;
+  }
+
+ protected:
+  void GetZone(int zone, int& x, int& y, int& width, int& height) const
+  {
+    x = (zone % m_zoneColumns) * m_zoneWidth;
+    y = (zone / m_zoneColumns) * m_zoneHeight;
+    width = m_width - x < m_zoneWidth ? m_width - x : m_zoneWidth;
+    height = m_height - y < m_zoneHeight ? m_height - y : m_zoneHeight;
+  }
+
+  uint32_t LoadPixel(const uint8_t* p) const
+  {
+    uint32_t pixel = p[0];
+    if (m_bytesPerPixel > 1) pixel |= p[1] << 8;
+    if (m_bytesPerPixel > 2) pixel |= p[2] << 16;
+    return pixel;
+  }
+
+  void StorePixel(uint8_t* p, uint32_t pixel) const
+  {
+    p[0] = (uint8_t)pixel;
+    if (m_bytesPerPixel > 1) p[1] = (uint8_t)(pixel >> 8);
+    if (m_bytesPerPixel > 2) p[2] = (uint8_t)(pixel >> 16);
+  }
+
+  int m_width;
+  int m_height;
+  int m_bytesPerPixel;
+  int m_zoneWidth;
+  int m_zoneHeight;
+  int m_zoneColumns;
+  int m_zoneRows;
+};
+
+class FrameEncoder : public FrameCodec
+{
+ public:
+  FrameEncoder(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth = 16, int zoneHeight = 8);
+
+  // Encodes pFrame into pOut and returns the number of bytes written, or 0 if capacity is too small. In that case the
+  // next frame is sent as a keyframe, so the decoder never misses a change.
+  size_t Encode(const uint8_t* pFrame, uint8_t* pOut, size_t capacity);
+  void ForceKeyframe() { m_diff.Reset(); }
+
+ private:
+  size_t EncodeZone(const uint8_t* pFrame, int zone, uint8_t* pOut, size_t capacity);
+
+  FrameDiff m_diff;
+  std::vector<uint32_t> m_pixels;
+};
+
+class FrameDecoder : public FrameCodec
+{
+ public:
+  FrameDecoder(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth = 16, int zoneHeight = 8);
+
+  // Applies one encoded frame, returns false if the data is malformed or the decoder still waits for a keyframe.
+  bool Decode(const uint8_t* pData, size_t size);
+  const uint8_t* GetFrame() const { return m_frame.data(); }
+
+ private:
+  bool DecodeZone(int zone, const uint8_t*& pData, const uint8_t* pEnd);
+
+  std::vector<uint8_t> m_frame;
+  std::vector<uint32_t> m_pixels;
+  bool m_valid = false;
+};
+
+inline FrameEncoder::FrameEncoder(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth,
+                                  int zoneHeight)
+    : FrameCodec(width, height, bytesPerPixel, zoneWidth, zoneHeight),
+      m_diff(width, height, bytesPerPixel, zoneWidth, zoneHeight)
+{
+  m_pixels.resize(zoneWidth * zoneHeight);
+}
+
+inline size_t FrameEncoder::Encode(const uint8_t* pFrame, uint8_t* pOut, size_t capacity)
+{
+  int zones = GetZoneCount();
+  size_t bitmapSize = (zones + 7) / 8;
+
+  // The first frame after a reset reports every zone as changed. Any other frame that changed all zones is sent as
+  // keyframe as well, which saves the bitmap.
+  m_diff.Update(pFrame);
+  bool keyframe = zones > 0 && m_diff.GetChangedZoneCount() == zones;
+
+  size_t pos = 1;
+  if (capacity < 1 + (keyframe ? 0 : bitmapSize))
+  {
+    m_diff.Reset();
+    return 0;
+  }
+  pOut[0] = keyframe ? Keyframe : 0;
+  if (!keyframe)
+  {
+    memset(&pOut[pos], 0, bitmapSize);
+    for (int zone = 0; zone < zones; zone++)
+    {
+      if (m_diff.IsZoneChanged(zone % m_zoneColumns, zone / m_zoneColumns)) pOut[pos + zone / 8] |= 1 << (zone % 8);
+    }
+    pos += bitmapSize;
+  }
+
+  for (int zone = 0; zone < zones; zone++)
+  {
+    if (!m_diff.IsZoneChanged(zone % m_zoneColumns, zone / m_zoneColumns)) continue;
+
+    size_t written = EncodeZone(pFrame, zone, &pOut[pos], capacity - pos);
+    if (written == 0)
+    {
+      m_diff.Reset();
+      return 0;
+    }
+    pos += written;
+  }
+
+  return pos;
+}
+
+inline size_t FrameEncoder::EncodeZone(const uint8_t* pFrame, int zone, uint8_t* pOut, size_t capacity)
+{
+  int x0, y0, width, height;
+  GetZone(zone, x0, y0, width, height);
+  int count = width * height;
+
+  // Gather the zone, count its runs and up to 17 distinct colors in the same pass.
+  uint32_t colors[17];
+  int numColors = 0;
+  int runs = 0;
+  int runLength = 0;
+  for (int y = 0; y < height; y++)
+  {
+    const uint8_t* pRow = &pFrame[((size_t)(y0 + y) * m_width + x0) * m_bytesPerPixel];
+    for (int x = 0; x < width; x++)
+    {
+      int i = y * width + x;
+      uint32_t pixel = LoadPixel(&pRow[x * m_bytesPerPixel]);
+      m_pixels[i] = pixel;
+      // Runs are cut exactly where the RLE writer below cuts them.
+      if (i == 0 || pixel != m_pixels[i - 1] || runLength == 256)
+      {
+        runs++;
+        runLength = 0;
+      }
+      runLength++;
+
+      if (numColors <= 16)
+      {
+        int c = 0;
+        while (c < numColors && colors[c] != pixel) c++;
+        if (c == numColors) colors[numColors++] = pixel;
+      }
+    }
+  }
+
+  int bits = numColors == 1 ? 0 : (numColors == 2 ? 1 : (numColors <= 4 ? 2 : 4));
+  size_t rawSize = (size_t)count * m_bytesPerPixel;
+  size_t rleSize = (size_t)runs * (1 + m_bytesPerPixel);
+  size_t paletteSize = numColors <= 16 ? 1 + numColors * m_bytesPerPixel + (count * bits + 7) / 8 : rawSize + 1;
+
+  size_t size = 1 + (rawSize <= rleSize && rawSize <= paletteSize ? rawSize
+                                                                   : (rleSize <= paletteSize ? rleSize : paletteSize));
+  if (size > capacity) return 0;
+
+  uint8_t* p = pOut + 1;
+  if (rawSize <= rleSize && rawSize <= paletteSize)
+  {
+    pOut[0] = ZoneRaw;
+    for (int i = 0; i < count; i++, p += m_bytesPerPixel)
+    {
+      StorePixel(p, m_pixels[i]);
+    }
+  }
+  else if (rleSize <= paletteSize)
+  {
+    pOut[0] = ZoneRle;
+    for (int i = 0; i < count;)
+    {
+      int run = 1;
+      while (i + run < count && run < 256 && m_pixels[i + run] == m_pixels[i]) run++;
+      *p++ = (uint8_t)(run - 1);
+      StorePixel(p, m_pixels[i]);
+      p += m_bytesPerPixel;
+      i += run;
+    }
+  }
+  else
+  {
+    pOut[0] = (uint8_t)(ZonePalette + bits);
+    *p++ = (uint8_t)(numColors - 1);
+    for (int c = 0; c < numColors; c++, p += m_bytesPerPixel)
+    {
+      StorePixel(p, colors[c]);
+    }
+    if (bits > 0)
+    {
+      memset(p, 0, (count * bits + 7) / 8);
+      for (int i = 0; i < count; i++)
+      {
+        int c = 0;
+        while (colors[c] != m_pixels[i]) c++;
+        p[(i * bits) / 8] |= c << ((i * bits) % 8);
+      }
+    }
+  }
+
+  return size;
+}
+
+inline FrameDecoder::FrameDecoder(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth,
+                                  int zoneHeight)
+    : FrameCodec(width, height, bytesPerPixel, zoneWidth, zoneHeight)
+{
+  m_frame.resize((size_t)width * height * bytesPerPixel);
+  m_pixels.resize(zoneWidth * zoneHeight);
+}
+
+inline bool FrameDecoder::Decode(const uint8_t* pData, size_t size)
+{
+  const uint8_t* pEnd = pData + size;
+  int zones = GetZoneCount();
+  size_t bitmapSize = (zones + 7) / 8;
+
+  if (size < 1) return false;
+  bool keyframe = (pData[0] & Keyframe) != 0;
+  if (!keyframe && (!m_valid || size < 1 + bitmapSize)) return false;
+
+  const uint8_t* pBitmap = pData + 1;
+  const uint8_t* p = keyframe ? pData + 1 : pData + 1 + bitmapSize;
+  for (int zone = 0; zone < zones; zone++)
+  {
+    if (!keyframe && !(pBitmap[zone / 8] & (1 << (zone % 8)))) continue;
+    if (!DecodeZone(zone, p, pEnd))
+    {
+      // The frame is only partially applied, don't build on it.
+      m_valid = false;
+      return false;
+    }
+  }
+
+  m_valid = true;
+  return true;
+}
+
+inline bool FrameDecoder::DecodeZone(int zone, const uint8_t*& pData, const uint8_t* pEnd)
+{
+  int x0, y0, width, height;
+  GetZone(zone, x0, y0, width, height);
+  int count = width * height;
+  const uint8_t* p = pData;
+
+  if (p >= pEnd) return false;
+  uint8_t mode = *p++;
+
+  if (mode == ZoneRaw)
+  {
+    if (pEnd - p < (ptrdiff_t)count * m_bytesPerPixel) return false;
+    for (int i = 0; i < count; i++, p += m_bytesPerPixel)
+    {
+      m_pixels[i] = LoadPixel(p);
+    }
+  }
+  else if (mode == ZoneRle)
+  {
+    for (int i = 0; i < count;)
+    {
+      if (pEnd - p < 1 + m_bytesPerPixel) return false;
+      int run = *p++ + 1;
+      uint32_t pixel = LoadPixel(p);
+      p += m_bytesPerPixel;
+      if (run > count - i) return false;
+      for (int end = i + run; i < end; i++)
+      {
+        m_pixels[i] = pixel;
+      }
+    }
+  }
+  else if (mode >= ZonePalette && mode <= ZonePalette + 4 && mode != ZonePalette + 3)
+  {
+    int bits = mode - ZonePalette;
+    if (p >= pEnd) return false;
+    int numColors = *p++ + 1;
+    if (numColors > 16 || pEnd - p < (ptrdiff_t)numColors * m_bytesPerPixel + (count * bits + 7) / 8) return false;
+
+    uint32_t colors[16];
+    for (int c = 0; c < numColors; c++, p += m_bytesPerPixel)
+    {
+      colors[c] = LoadPixel(p);
+    }
+    int mask = (1 << bits) - 1;
+    for (int i = 0; i < count; i++)
+    {
+      int c = bits > 0 ? (p[(i * bits) / 8] >> ((i * bits) % 8)) & mask : 0;
+      if (c >= numColors) return false;
+      m_pixels[i] = colors[c];
+    }
+    p += (count * bits + 7) / 8;
+  }
+  else
+  {
+    return false;
+  }
+
+  for (int y = 0; y < height; y++)
+  {
+    uint8_t* pRow = &m_frame[((size_t)(y0 + y) * m_width + x0) * m_bytesPerPixel];
+    for (int x = 0; x < width; x++)
+    {
+      StorePixel(&pRow[x * m_bytesPerPixel], m_pixels[y * width + x]);
+    }
+  }
+
+  pData = p;
+  return true;
+}
+
+}  // namespace FrameUtil
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <vector>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Tracks which parts of a frame changed since the previous one, so a sender only has to transmit those. Update()
+// compares the new frame against its own copy of the previous frame in one streaming pass and stores it, reporting
+// the changed rows, the changed zones as a bitmask and, if enabled, the bounding box of all changed pixels.
+class FrameDiff
+{
+ public:
+  FrameDiff(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth = 16, int zoneHeight = 8,
+            bool boundingBox = false);
+
+  // Returns true if anything changed. The first frame after construction or Reset() counts as fully changed.
+  bool Update(const uint8_t* pFrame);
+  void Reset() { m_valid = false; }
+
+  int GetZoneColumns() const { return m_zoneColumns; }
+  int GetZoneRows() const { return m_zoneRows; }
+  bool IsRowChanged(int y) const { return (m_changedRows[y / 64] >> (y % 64)) & 1; }
+  bool IsZoneChanged(int zoneX, int zoneY) const
+  {
+    int zone = zoneY * m_zoneColumns + zoneX;
+    return (m_changedZones[zone / 64] >> (zone % 64)) & 1;
+  }
+  // Bit y of the row mask, bit zoneY * GetZoneColumns() + zoneX of the zone mask, 64 bits per word.
+  const std::vector<uint64_t>& GetChangedRows() const { return m_changedRows; }
+  const std::vector<uint64_t>& GetChangedZones() const { return m_changedZones; }
+  int GetChangedRowCount() const { return m_changedRowCount; }
+  int GetChangedZoneCount() const { return m_changedZoneCount; }
+  // Only available if the bounding box was enabled, returns false if nothing changed.
+  bool GetBoundingBox(int& x, int& y, int& width, int& height) const;
+
+ private:
+  void MarkZone(int zone);
+
+  int m_width;
+  int m_height;
+  int m_bytesPerPixel;
+  int m_zoneWidth;
+  int m_zoneHeight;
+  int m_zoneColumns;
+  int m_zoneRows;
+  bool m_boundingBox;
+
+  bool m_valid = false;
+  std::vector<uint8_t> m_previous;
+  std::vector<uint64_t> m_changedRows;
+  std::vector<uint64_t> m_changedZones;
+  int m_changedRowCount = 0;
+  int m_changedZoneCount = 0;
+  int m_minX = 0;
+  int m_maxX = -1;
+  int m_minY = 0;
+  int m_maxY = -1;
+};
+
+namespace Detail
+{
+
+// Compares n bytes and returns true if they are equal.
+inline bool Equal(const uint8_t* a, const uint8_t* b, int n)
+{
+  int i = 0;
+
+#if defined(FRAMEUTIL_AVX2)
+  for (; i + 32 <= n; i += 32)
+  {
+    __m256i diff =
+        _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&a[i]), _mm256_loadu_si256((const __m256i*)&b[i]));
+    if (!_mm256_testz_si256(diff, diff)) return false;
+  }
+#endif
+
+#if defined(FRAMEUTIL_SSE2)
+  for (; i + 16 <= n; i += 16)
+  {
+    __m128i same = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)&a[i]), _mm_loadu_si128((const __m128i*)&b[i]));
+    if (_mm_movemask_epi8(same) != 0xffff) return false;
+  }
+#elif defined(FRAMEUTIL_NEON)
+  for (; i + 16 <= n; i += 16)
+  {
+    uint8x16_t diff = veorq_u8(vld1q_u8(&a[i]), vld1q_u8(&b[i]));
+    uint64x2_t wide = vreinterpretq_u64_u8(diff);
+    if ((vgetq_lane_u64(wide, 0) | vgetq_lane_u64(wide, 1)) != 0) return false;
+  }
+#endif
+
+  for (; i + 8 <= n; i += 8)
+  {
+    if (Load64(&a[i]) != Load64(&b[i])) return false;
+  }
+  for (; i < n; i++)
+  {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+}  // namespace Detail
+
+inline FrameDiff::FrameDiff(uint16_t width, uint16_t height, uint8_t bytesPerPixel, int zoneWidth, int zoneHeight,
+                            bool boundingBox)
+    : m_width(width),
+      m_height(height),
+      m_bytesPerPixel(bytesPerPixel),
+      m_zoneWidth(zoneWidth),
+      m_zoneHeight(zoneHeight),
+      m_zoneColumns((width + zoneWidth - 1) / zoneWidth),
+      m_zoneRows((height + zoneHeight - 1) / zoneHeight),
+      m_boundingBox(boundingBox)
+{
+  m_previous.resize((size_t)width * height * bytesPerPixel);
+  m_changedRows.resize((height + 63) / 64);
+  m_changedZones.resize((m_zoneColumns * m_zoneRows + 63) / 64);
+}
+
+inline void FrameDiff::MarkZone(int zone)
+{
+  uint64_t bit = 1ULL << (zone % 64);
+  if (m_changedZones[zone / 64] & bit) return;
+  m_changedZones[zone / 64] |= bit;
+  m_changedZoneCount++;
+}
+
+inline bool FrameDiff::Update(const uint8_t* pFrame)
+{
+  const int rowBytes = m_width * m_bytesPerPixel;
+  const int zoneBytes = m_zoneWidth * m_bytesPerPixel;
+
+  memset(m_changedRows.data(), 0, m_changedRows.size() * sizeof(uint64_t));
+  memset(m_changedZones.data(), 0, m_changedZones.size() * sizeof(uint64_t));
+  m_changedRowCount = 0;
+  m_changedZoneCount = 0;
+  m_minX = m_width;
+  m_maxX = -1;
+  m_minY = m_height;
+  m_maxY = -1;
+
+  if (!m_valid)
+  {
+    memcpy(m_previous.data(), pFrame, m_previous.size());
+    for (int y = 0; y < m_height; y++)
+    {
+      m_changedRows[y / 64] |= 1ULL << (y % 64);
+    }
+    for (int zone = 0; zone < m_zoneColumns * m_zoneRows; zone++)
+    {
+      m_changedZones[zone / 64] |= 1ULL << (zone % 64);
+    }
+    m_changedRowCount = m_height;
+    m_changedZoneCount = m_zoneColumns * m_zoneRows;
+    m_minX = m_minY = 0;
+    m_maxX = m_width - 1;
+    m_maxY = m_height - 1;
+    m_valid = true;
+    return m_height > 0 && m_width > 0;
+  }
+
+  for (int y = 0; y < m_height; y++)
+  {
+    uint8_t* pPrevious = &m_previous[(size_t)y * rowBytes];
+    const uint8_t* pCurrent = &pFrame[(size_t)y * rowBytes];
+    int zoneRow = (y / m_zoneHeight) * m_zoneColumns;
+    bool rowChanged = false;
+
+    for (int offset = 0, zoneX = 0; offset < rowBytes; offset += zoneBytes, zoneX++)
+    {
+      int bytes = rowBytes - offset < zoneBytes ? rowBytes - offset : zoneBytes;
+      if (Detail::Equal(&pPrevious[offset], &pCurrent[offset], bytes)) continue;
+
+      if (m_boundingBox)
+      {
+        // Only the outermost changed pixels of a row can widen the box.
+        int first = offset;
+        int last = offset + bytes - 1;
+        if (first / m_bytesPerPixel < m_minX)
+        {
+          while (pPrevious[first] == pCurrent[first]) first++;
+          if (first / m_bytesPerPixel < m_minX) m_minX = first / m_bytesPerPixel;
+        }
+        if (last / m_bytesPerPixel > m_maxX)
+        {
+          while (pPrevious[last] == pCurrent[last]) last--;
+          if (last / m_bytesPerPixel > m_maxX) m_maxX = last / m_bytesPerPixel;
+        }
+      }
+
+      // Unchanged zones never need to be written back.
+      memcpy(&pPrevious[offset], &pCurrent[offset], bytes);
+      MarkZone(zoneRow + zoneX);
+      rowChanged = true;
+    }
+
+    if (rowChanged)
+    {
+      m_changedRows[y / 64] |= 1ULL << (y % 64);
+      m_changedRowCount++;
+      if (y < m_minY) m_minY = y;
+      m_maxY = y;
+    }
+  }
+
+  return m_changedRowCount > 0;
+}
+
+inline bool FrameDiff::GetBoundingBox(int& x, int& y, int& width, int& height) const
+{
+  if (!m_boundingBox || m_maxY < 0) return false;
+
+  x = m_minX;
+  y = m_minY;
+  width = m_maxX - m_minX + 1;
+  height = m_maxY - m_minY + 1;
+  return true;
+}
+
+}  // namespace FrameUtil
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Binary frame dump, all numbers little endian:
+//
+//   0   "FDMP"
+//   4   uint16 version
+//   6   uint16 width
+//   8   uint16 height
+//   10  uint8  PixelFormat
+//   11  uint8  significant bits of indexed pixels, 0 if unknown
+//   12  uint16 number of palette colors
+//   14  uint16 reserved
+//   16  uint32 offset of the first frame record
+//   20  uint32 size of a frame record
+//   24  8 bytes reserved
+//   32  palette, 3 bytes per color
+//
+// The frame records follow at the given offset: a uint64 timestamp in microseconds, then the packed pixels, padded
+// to a multiple of 8 bytes. As every record has the same size the records are their own index, frame i is found
+// without any lookup and a file cut off while writing still holds every complete frame before the cut.
+struct FrameDumpInfo
+{
+  uint16_t width = 0;
+  uint16_t height = 0;
+  PixelFormat format = PixelFormat::Indexed;
+  uint8_t bitlen = 0;
+  // 3 bytes per color, may be empty.
+  std::vector<uint8_t> palette;
+
+  size_t GetFrameSize() const { return (size_t)width * height * FrameView::GetPixelBytes(format); }
+};
+
+// Maps a dump and hands out its frames without copying them. Opening a capture of any size costs the same, pages
+// are only read when a frame is used.
+class FrameDumpReader
+{
+ public:
+  FrameDumpReader() {}
+  ~FrameDumpReader() { Close(); }
+
+  FrameDumpReader(const FrameDumpReader&) = delete;
+  FrameDumpReader& operator=(const FrameDumpReader&) = delete;
+
+  // Returns false if the file can't be mapped or is no dump.
+  bool Open(const char* pPath);
+  void Close();
+
+  bool IsOpen() const { return m_pData != nullptr; }
+  const FrameDumpInfo& GetInfo() const { return m_info; }
+  size_t GetFrameCount() const { return m_frameCount; }
+  uint64_t GetTimestamp(size_t index) const;
+  const uint8_t* GetFrame(size_t index) const { return &m_pData[m_dataOffset + index * m_recordSize + 8]; }
+  // The mapping is copy on write, changes through a view stay private to this reader and never reach the file.
+  FrameView GetView(size_t index) const;
+  // Returns the last frame shown at the given time, i.e. the last one with a timestamp not after it, or 0.
+  size_t FindFrame(uint64_t timestamp) const;
+
+ private:
+  uint8_t* m_pData = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  HANDLE m_file = INVALID_HANDLE_VALUE;
+  HANDLE m_mapping = nullptr;
+#endif
+  FrameDumpInfo m_info;
+  size_t m_dataOffset = 0;
+  size_t m_recordSize = 0;
+  size_t m_frameCount = 0;
+};
+
+// Writes a dump frame by frame. Records go through the stdio buffer, so a long capture never has to be held in memory.
+class FrameDumpWriter
+{
+ public:
+  FrameDumpWriter() {}
+  ~FrameDumpWriter() { Close(); }
+
+  FrameDumpWriter(const FrameDumpWriter&) = delete;
+  FrameDumpWriter& operator=(const FrameDumpWriter&) = delete;
+
+  // Creates the file. With append an existing dump of the same size and pixel format is continued after its last
+  // complete frame instead, keeping its palette.
+  bool Open(const char* pPath, const FrameDumpInfo& info, bool append = false);
+  // Timestamps are in microseconds and must not decrease.
+  bool Write(const uint8_t* pFrame, uint64_t timestamp);
+  bool Flush();
+  void Close();
+
+  bool IsOpen() const { return m_pFile != nullptr; }
+  const FrameDumpInfo& GetInfo() const { return m_info; }
+  size_t GetFrameCount() const { return m_frameCount; }
+
+ private:
+  FILE* m_pFile = nullptr;
+  FrameDumpInfo m_info;
+  size_t m_frameCount = 0;
+  uint64_t m_lastTimestamp = 0;
+  std::vector<uint8_t> m_record;
+};
+
+// Reads a DMDExt text dump: for every frame a line with the timestamp in milliseconds as 0x%08x, one line of hex
+// digits per row with one digit per pixel, and an empty line. Calls onFrame with one byte per pixel for every frame
+// until it returns false. Returns false if the file can't be read or holds a frame of inconsistent size.
+bool ReadDmdExtDump(
+    const char* pPath,
+    const std::function<bool(const uint8_t* pFrame, int width, int height, uint64_t timestampMs)>& onFrame);
+
+// Converts a DMDExt text dump into a binary dump of indexed frames and returns the number of frames, or -1 on error.
+// The bit depth is taken from the highest pixel value.
+int ImportDmdExtDump(const char* pTextPath, const char* pDumpPath, const uint8_t* pPalette = nullptr,
+                     int numColors = 0);
+
+namespace Detail
+{
+
+constexpr uint16_t DumpVersion = 1;
+constexpr size_t DumpHeaderSize = 32;
+
+inline uint64_t LoadLittleEndian(const uint8_t* p, int bytes)
+{
+  uint64_t value = 0;
+  for (int i = bytes - 1; i >= 0; i--)
+  {
+    value = value << 8 | p[i];
+  }
+  return value;
+}
+
+inline void StoreLittleEndian(uint8_t* p, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; i++, value >>= 8)
+  {
+    p[i] = (uint8_t)value;
+  }
+}
+
+// Captures easily get larger than the 2 GB a long can address on Windows.
+inline bool SeekFile(FILE* pFile, uint64_t offset, int origin = SEEK_SET)
+{
+#if defined(_WIN32)
+  return _fseeki64(pFile, (__int64)offset, origin) == 0;
+#else
+  return fseeko(pFile, (off_t)offset, origin) == 0;
+#endif
+}
+
+inline uint64_t TellFile(FILE* pFile)
+{
+#if defined(_WIN32)
+  return (uint64_t)_ftelli64(pFile);
+#else
+  return (uint64_t)ftello(pFile);
+#endif
+}
+
+inline size_t GetDumpRecordSize(const FrameDumpInfo& info) { return (8 + info.GetFrameSize() + 7) / 8 * 8; }
+
+inline bool WriteDumpHeader(FILE* pFile, const FrameDumpInfo& info)
+{
+  size_t paletteSize = info.palette.size() / 3 * 3;
+  // Frames start on a cache line.
+  size_t dataOffset = (DumpHeaderSize + paletteSize + 63) / 64 * 64;
+
+  uint8_t fields[DumpHeaderSize] = {};
+  memcpy(fields, "FDMP", 4);
+  StoreLittleEndian(&fields[4], DumpVersion, 2);
+  StoreLittleEndian(&fields[6], info.width, 2);
+  StoreLittleEndian(&fields[8], info.height, 2);
+  fields[10] = (uint8_t)info.format;
+  fields[11] = info.bitlen;
+  StoreLittleEndian(&fields[12], paletteSize / 3, 2);
+  StoreLittleEndian(&fields[16], dataOffset, 4);
+  StoreLittleEndian(&fields[20], GetDumpRecordSize(info), 4);
+
+  static const uint8_t padding[64] = {};
+  size_t paddingSize = dataOffset - DumpHeaderSize - paletteSize;
+  return fwrite(fields, 1, DumpHeaderSize, pFile) == DumpHeaderSize &&
+         (paletteSize == 0 || fwrite(info.palette.data(), 1, paletteSize, pFile) == paletteSize) &&
+         fwrite(padding, 1, paddingSize, pFile) == paddingSize;
+}
+
+// Checks the header of size bytes at p and returns the offset of the first record, or 0 if it is no valid dump.
+inline size_t ParseDumpHeader(const uint8_t* p, size_t size, FrameDumpInfo& info)
+{
+  if (size < DumpHeaderSize || memcmp(p, "FDMP", 4) != 0 || LoadLittleEndian(&p[4], 2) != DumpVersion) return 0;
+  if (p[10] > (uint8_t)PixelFormat::Rgba32) return 0;
+
+  info.width = (uint16_t)LoadLittleEndian(&p[6], 2);
+  info.height = (uint16_t)LoadLittleEndian(&p[8], 2);
+  info.format = (PixelFormat)p[10];
+  info.bitlen = p[11];
+  size_t numColors = (size_t)LoadLittleEndian(&p[12], 2);
+  size_t dataOffset = (size_t)LoadLittleEndian(&p[16], 4);
+  size_t recordSize = (size_t)LoadLittleEndian(&p[20], 4);
+
+  if (numColors > 256 || dataOffset < DumpHeaderSize + numColors * 3 || recordSize != GetDumpRecordSize(info))
+    return 0;
+  if (size < DumpHeaderSize + numColors * 3) return 0;
+  info.palette.assign(&p[DumpHeaderSize], &p[DumpHeaderSize + numColors * 3]);
+  return dataOffset;
+}
+
+}  // namespace Detail
+
+inline bool FrameDumpReader::Open(const char* pPath)
+{
+  Close();
+
+#if defined(_WIN32)
+  m_file = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+  {
+    Close();
+    return false;
+  }
+  m_size = (size_t)size.QuadPart;
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if (m_mapping) m_pData = (uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0);
+#else
+  int fd = open(pPath, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat status;
+  if (fstat(fd, &status) == 0 && status.st_size > 0)
+  {
+    m_size = (size_t)status.st_size;
+    void* pMapped = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (pMapped != MAP_FAILED) m_pData = (uint8_t*)pMapped;
+  }
+  // The mapping keeps the file alive on its own.
+  close(fd);
+#endif
+  if (!m_pData)
+  {
+    Close();
+    return false;
+  }
+
+  m_dataOffset = Detail::ParseDumpHeader(m_pData, m_size, m_info);
+  if (m_dataOffset == 0 || m_dataOffset > m_size)
+  {
+    Close();
+    return false;
+  }
+  m_recordSize = Detail::GetDumpRecordSize(m_info);
+  m_frameCount = (m_size - m_dataOffset) / m_recordSize;
+  return true;
+}
+
+inline void FrameDumpReader::Close()
+{
+#if defined(_WIN32)
+  if (m_pData) UnmapViewOfFile(m_pData);
+  if (m_mapping) CloseHandle(m_mapping);
+  if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+  m_mapping = nullptr;
+  m_file = INVALID_HANDLE_VALUE;
+#else
+  if (m_pData) munmap(m_pData, m_size);
+#endif
+  m_pData = nullptr;
+  m_size = 0;
+  m_info = FrameDumpInfo();
+  m_dataOffset = 0;
+  m_recordSize = 0;
+  m_frameCount = 0;
+}
+
+inline uint64_t FrameDumpReader::GetTimestamp(size_t index) const
+{
+  return Detail::LoadLittleEndian(&m_pData[m_dataOffset + index * m_recordSize], 8);
+}
+
+inline FrameView FrameDumpReader::GetView(size_t index) const
+{
+  return FrameView(const_cast<uint8_t*>(GetFrame(index)), m_info.width, m_info.height, m_info.format);
+}
+
+inline size_t FrameDumpReader::FindFrame(uint64_t timestamp) const
+{
+  size_t first = 0;
+  size_t count = m_frameCount;
+  // Finds the first frame after timestamp.
+  while (count > 0)
+  {
+    size_t step = count / 2;
+    if (GetTimestamp(first + step) <= timestamp)
+    {
+      first += step + 1;
+      count -= step + 1;
+    }
+    else
+    {
+      count = step;
+    }
+  }
+  return first > 0 ? first - 1 : 0;
+}
+
+inline bool FrameDumpWriter::Open(const char* pPath, const FrameDumpInfo& info, bool append)
+{
+  Close();
+
+  m_info = info;
+  m_frameCount = 0;
+  m_lastTimestamp = 0;
+
+  if (append) m_pFile = fopen(pPath, "r+b");
+  if (m_pFile)
+  {
+    // Continue after the last complete record, a partial one left by a crash gets overwritten.
+    uint8_t header[Detail::DumpHeaderSize + 256 * 3];
+    size_t read = fread(header, 1, sizeof(header), m_pFile);
+    FrameDumpInfo existing;
+    size_t dataOffset = Detail::ParseDumpHeader(header, read, existing);
+    if (dataOffset == 0 || existing.width != info.width || existing.height != info.height ||
+        existing.format != info.format || !Detail::SeekFile(m_pFile, 0, SEEK_END))
+    {
+      Close();
+      return false;
+    }
+    m_info = existing;
+
+    uint64_t size = Detail::TellFile(m_pFile);
+    size_t recordSize = Detail::GetDumpRecordSize(m_info);
+    m_frameCount = size > dataOffset ? (size_t)((size - dataOffset) / recordSize) : 0;
+    if (m_frameCount > 0)
+    {
+      uint8_t timestamp[8];
+      if (!Detail::SeekFile(m_pFile, dataOffset + (uint64_t)(m_frameCount - 1) * recordSize) ||
+          fread(timestamp, 1, 8, m_pFile) != 8)
+      {
+        Close();
+        return false;
+      }
+      m_lastTimestamp = Detail::LoadLittleEndian(timestamp, 8);
+    }
+    if (!Detail::SeekFile(m_pFile, dataOffset + (uint64_t)m_frameCount * recordSize))
+    {
+      Close();
+      return false;
+    }
+  }
+  else
+  {
+    if (info.width == 0 || info.height == 0 || info.palette.size() > 256 * 3) return false;
+    m_pFile = fopen(pPath, "wb");
+    if (!m_pFile) return false;
+
+    if (!Detail::WriteDumpHeader(m_pFile, info))
+    {
+      Close();
+      return false;
+    }
+  }
+
+  m_record.assign(Detail::GetDumpRecordSize(m_info), 0);
+  return true;
+}
+
+inline bool FrameDumpWriter::Write(const uint8_t* pFrame, uint64_t timestamp)
+{
+  if (!m_pFile || (m_frameCount > 0 && timestamp < m_lastTimestamp)) return false;
+
+  Detail::StoreLittleEndian(m_record.data(), timestamp, 8);
+  memcpy(&m_record[8], pFrame, m_info.GetFrameSize());
+  if (fwrite(m_record.data(), 1, m_record.size(), m_pFile) != m_record.size()) return false;
+
+  m_frameCount++;
+  m_lastTimestamp = timestamp;
+  return true;
+}
+
+inline bool FrameDumpWriter::Flush() { return m_pFile && fflush(m_pFile) == 0; }
+
+inline void FrameDumpWriter::Close()
+{
+  if (m_pFile) fclose(m_pFile);
+  m_pFile = nullptr;
+}
+
+inline bool ReadDmdExtDump(
+    const char* pPath,
+    const std::function<bool(const uint8_t* pFrame, int width, int height, uint64_t timestampMs)>& onFrame)
+{
+  FILE* pFile = fopen(pPath, "r");
+  if (!pFile) return false;
+
+  std::vector<uint8_t> frame;
+  int width = 0;
+  int height = 0;
+  uint64_t timestamp = 0;
+  bool valid = true;
+  bool more = true;
+  char line[4096];
+
+  auto finish = [&]()
+  {
+    if (height > 0) more = onFrame(frame.data(), width, height, timestamp);
+    frame.clear();
+    height = 0;
+  };
+
+  while (valid && more && fgets(line, sizeof(line), pFile))
+  {
+    size_t length = strcspn(line, "\r\n");
+    if (length == 0)
+    {
+      finish();
+      continue;
+    }
+    if (length > 2 && line[0] == '0' && (line[1] == 'x' || line[1] == 'X'))
+    {
+      finish();
+      timestamp = strtoull(line, nullptr, 16);
+      continue;
+    }
+
+    if (width == 0) width = (int)length;
+    if ((int)length != width)
+    {
+      valid = false;
+      break;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+      char c = line[i];
+      if (c >= '0' && c <= '9')
+        frame.push_back((uint8_t)(c - '0'));
+      else if (c >= 'a' && c <= 'f')
+        frame.push_back((uint8_t)(c - 'a' + 10));
+      else if (c >= 'A' && c <= 'F')
+        frame.push_back((uint8_t)(c - 'A' + 10));
+      else
+        valid = false;
+    }
+    height++;
+  }
+  if (valid && more) finish();
+
+  fclose(pFile);
+  return valid;
+}
+
+inline int ImportDmdExtDump(const char* pTextPath, const char* pDumpPath, const uint8_t* pPalette, int numColors)
+{
+  // The header needs the size and bit depth up front, the text is cheap to read twice.
+  FrameDumpInfo info;
+  int height = 0;
+  uint8_t maxValue = 0;
+  bool consistent = true;
+  auto scan = [&](const uint8_t* pFrame, int width, int frameHeight, uint64_t)
+  {
+    if (height == 0) height = frameHeight;
+    if (frameHeight != height) consistent = false;
+    info.width = (uint16_t)width;
+    for (int i = 0; i < width * frameHeight; i++)
+    {
+      if (pFrame[i] > maxValue) maxValue = pFrame[i];
+    }
+    return consistent;
+  };
+  if (!ReadDmdExtDump(pTextPath, scan) || !consistent || height == 0) return -1;
+
+  info.height = (uint16_t)height;
+  info.format = PixelFormat::Indexed;
+  info.bitlen = maxValue < 4 ? 2 : 4;
+  if (pPalette && numColors > 0) info.palette.assign(pPalette, pPalette + numColors * 3);
+
+  FrameDumpWriter writer;
+  if (!writer.Open(pDumpPath, info)) return -1;
+  bool written = true;
+  auto write = [&](const uint8_t* pFrame, int, int, uint64_t timestampMs)
+  { return written = writer.Write(pFrame, timestampMs * 1000); };
+  if (!ReadDmdExtDump(pTextPath, write) || !written) return -1;
+
+  writer.Close();
+  return (int)writer.GetFrameCount();
+}
+
+}  // namespace FrameUtil
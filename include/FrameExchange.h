@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Hands frames from producer threads to one display thread, the latest frame wins. This is a triple buffer extended
+// to several producers: every producer owns one slot it renders into in place, the consumer owns the slot it shows,
+// and one more slot holds the latest published frame. One atomic word holds that slot together with its frame number,
+// so publishing and acquiring each swap the own slot with it in a single compare and exchange. Nobody ever waits for
+// a lock or copies a frame, frame numbers follow the order in which frames were really published, and the consumer
+// never sees a frame older than the latest one published before its Acquire().
+//
+// A frame published before the consumer picked up the previous one replaces it and counts as dropped.
+class FrameExchange
+{
+ public:
+  // Limited by the slot bits of the ready word.
+  static constexpr int MaxProducers = 0x7fff - 1;
+
+  struct Stats
+  {
+    uint64_t published;
+    uint64_t dropped;
+    uint64_t acquired;
+  };
+
+  FrameExchange(size_t frameSize, int numProducers = 1);
+  FrameExchange(int width, int height, PixelFormat format, int numProducers = 1)
+      : FrameExchange((size_t)width * height * FrameView::GetPixelBytes(format), numProducers)
+  {
+  }
+
+  FrameExchange(const FrameExchange&) = delete;
+  FrameExchange& operator=(const FrameExchange&) = delete;
+
+  size_t GetFrameSize() const { return m_frameSize; }
+  int GetNumProducers() const { return m_numProducers; }
+
+  // Producer side, every producer index must only be used by one thread at a time. The buffer keeps its content from
+  // whichever frame was in it before, it belongs to the producer until Publish().
+  uint8_t* GetWriteBuffer(int producer = 0) const { return GetSlot(m_producers[producer].slot); }
+  void Publish(int producer = 0);
+
+  // Consumer side. Returns the latest published frame, or nullptr if nothing was published since the last call. The
+  // frame stays valid until the next successful Acquire().
+  const uint8_t* Acquire();
+  // The frame returned by the last successful Acquire(), or nullptr before the first one.
+  const uint8_t* GetFrame() const { return m_consumer.hasFrame ? GetSlot(m_consumer.front) : nullptr; }
+  // Counts the frames published so far, starting at 1, in the order they were published.
+  uint64_t GetFrameNumber() const { return m_consumer.frameNumber; }
+
+  // Safe to call from any thread.
+  Stats GetStats() const;
+
+ private:
+  // Layout of the ready word: the slot, whether the consumer has yet to pick it up, and the number of the last
+  // frame published.
+  static constexpr uint64_t SlotMask = 0x7fff;
+  static constexpr uint64_t Fresh = 0x8000;
+  static constexpr int NumberShift = 16;
+
+  // Counters are only written by their owner, a plain store instead of a locked add keeps them free. Aligned, so
+  // producers never share a cache line.
+  struct alignas(64) Producer
+  {
+    uint32_t slot;
+    std::atomic<uint64_t> published;
+    std::atomic<uint64_t> dropped;
+  };
+
+  struct Consumer
+  {
+    // Keeps the consumer's fields off the line every Publish() writes to.
+    uint8_t padding[64];
+    uint32_t front;
+    bool hasFrame = false;
+    uint64_t frameNumber = 0;
+    std::atomic<uint64_t> acquired{0};
+  };
+
+  uint8_t* GetSlot(uint32_t slot) const { return m_pBuffer + slot * m_slotSize; }
+
+  size_t m_frameSize;
+  size_t m_slotSize;
+  int m_numProducers;
+  std::unique_ptr<uint8_t[]> m_storage;
+  uint8_t* m_pBuffer;
+  // C++14 new doesn't honour the alignment of Producer, they are placed in storage aligned by hand.
+  std::unique_ptr<uint8_t[]> m_producerStorage;
+  Producer* m_producers;
+
+  std::atomic<uint64_t> m_ready;
+  Consumer m_consumer;
+};
+
+inline FrameExchange::FrameExchange(size_t frameSize, int numProducers)
+    : m_frameSize(frameSize),
+      m_slotSize((frameSize + 63) / 64 * 64),
+      m_numProducers(numProducers < 1 ? 1 : (numProducers > MaxProducers ? MaxProducers : numProducers))
+{
+  int numSlots = m_numProducers + 2;
+  // Slots start on their own cache line, so producers never share one.
+  m_storage.reset(new uint8_t[m_slotSize * numSlots + 64]());
+  m_pBuffer = (uint8_t*)(((uintptr_t)m_storage.get() + 63) & ~(uintptr_t)63);
+
+  // Producer only holds atomics of integers, nothing to destroy.
+  m_producerStorage.reset(new uint8_t[sizeof(Producer) * m_numProducers + 64]);
+  m_producers = (Producer*)(((uintptr_t)m_producerStorage.get() + 63) & ~(uintptr_t)63);
+  for (int i = 0; i < m_numProducers; i++)
+  {
+    Producer* pProducer = new (&m_producers[i]) Producer();
+    pProducer->slot = (uint32_t)i;
+    pProducer->published.store(0, std::memory_order_relaxed);
+    pProducer->dropped.store(0, std::memory_order_relaxed);
+  }
+  m_ready.store((uint64_t)m_numProducers, std::memory_order_relaxed);
+  m_consumer.front = (uint32_t)m_numProducers + 1;
+}
+
+inline void FrameExchange::Publish(int producer)
+{
+  Producer& self = m_producers[producer];
+
+  // The frame number is taken in the same step that publishes the frame. Release hands over the frame, acquire takes
+  // over the slot only once its last reader is done with it.
+  uint64_t previous = m_ready.load(std::memory_order_relaxed);
+  uint64_t ready;
+  do
+  {
+    ready = ((previous >> NumberShift) + 1) << NumberShift | Fresh | self.slot;
+  } while (!m_ready.compare_exchange_weak(previous, ready, std::memory_order_acq_rel, std::memory_order_relaxed));
+  self.slot = (uint32_t)(previous & SlotMask);
+
+  self.published.store(self.published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (previous & Fresh)
+    self.dropped.store(self.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+inline const uint8_t* FrameExchange::Acquire()
+{
+  uint64_t ready = m_ready.load(std::memory_order_relaxed);
+  if (!(ready & Fresh)) return nullptr;
+
+  // Producers set slot and frame number together, so the number taken belongs to the frame taken. Only Acquire()
+  // clears Fresh, the slot stays fresh while the loop retries.
+  uint64_t front;
+  do
+  {
+    front = (ready & ~(SlotMask | Fresh)) | m_consumer.front;
+  } while (!m_ready.compare_exchange_weak(ready, front, std::memory_order_acq_rel, std::memory_order_relaxed));
+  m_consumer.front = (uint32_t)(ready & SlotMask);
+  m_consumer.frameNumber = ready >> NumberShift;
+  m_consumer.hasFrame = true;
+  m_consumer.acquired.store(m_consumer.acquired.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  return GetSlot(m_consumer.front);
+}
+
+inline FrameExchange::Stats FrameExchange::GetStats() const
+{
+  Stats stats = {0, 0, m_consumer.acquired.load(std::memory_order_relaxed)};
+  for (int i = 0; i < m_numProducers; i++)
+  {
+    stats.published += m_producers[i].published.load(std::memory_order_relaxed);
+    stats.dropped += m_producers[i].dropped.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+}  // namespace FrameUtil
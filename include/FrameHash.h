@@ -0,0 +1,377 @@
+#pragma once
+
+#include <vector>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Non-cryptographic 64-bit fingerprint of frames, masked frames and bit planes, used to suppress duplicate frames
+// and to look up colorization triggers. The data is consumed in 32 byte stripes of four 64-bit lanes, each stripe
+// mixed with its own key by a 32x32->64 bit multiply, and the lanes are scrambled after every 16 stripes. SSE2,
+// AVX2 and NEON compute exactly the same value as the scalar code.
+//
+// Update() can be called with any split of the data, for example row by row, and gives the same result as hashing
+// the concatenated data at once.
+class FrameHash
+{
+ public:
+  explicit FrameHash(uint64_t seed = 0) { Reset(seed); }
+
+  void Reset(uint64_t seed = 0);
+  void Update(const uint8_t* pData, size_t length);
+  // Every data byte is ANDed with its mask byte first, so 0x00 mask bytes exclude a pixel from the fingerprint.
+  void UpdateMasked(const uint8_t* pData, const uint8_t* pMask, size_t length);
+  // Doesn't change the state, more data can be added afterwards.
+  uint64_t Finish() const;
+
+  static uint64_t Hash(const uint8_t* pData, size_t length, uint64_t seed = 0);
+  static uint64_t HashMasked(const uint8_t* pData, const uint8_t* pMask, size_t length, uint64_t seed = 0);
+  // Hashes the planes written by Helper::Split() whose bit is set in planeMask.
+  static uint64_t HashPlanes(const uint8_t* pPlanes, int planeSize, uint8_t bitlen, uint8_t planeMask = 0xff,
+                             uint64_t seed = 0);
+
+ private:
+  template <bool Masked>
+  void UpdateImpl(const uint8_t* pData, const uint8_t* pMask, size_t length);
+
+  uint64_t m_acc[4];
+  uint8_t m_buffer[32];
+  int m_bufferLength;
+  int m_stripe;
+  uint64_t m_length;
+};
+
+// Fixed size LRU cache from a fingerprint to an already converted frame, so repeated frames can skip the conversion.
+class FrameCache
+{
+ public:
+  FrameCache(int numEntries, size_t frameSize);
+
+  // Returns the cached frame or nullptr, a hit makes the entry the most recently used one.
+  const uint8_t* Find(uint64_t hash);
+  // Stores a copy of pFrame, replacing the least recently used entry.
+  void Insert(uint64_t hash, const uint8_t* pFrame);
+  void Clear();
+
+  int GetNumEntries() const { return (int)m_hashes.size(); }
+  size_t GetFrameSize() const { return m_frameSize; }
+
+ private:
+  size_t m_frameSize;
+  std::vector<uint64_t> m_hashes;
+  // 0 marks an empty entry.
+  std::vector<uint64_t> m_lastUse;
+  std::vector<uint8_t> m_frames;
+  uint64_t m_clock = 0;
+};
+
+namespace Detail
+{
+
+constexpr uint64_t HashPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t HashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t HashPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint32_t HashPrime32 = 0x9E3779B1U;
+
+// 16 stripe keys, followed by the scramble and the final keys, 4 lanes each.
+inline const uint64_t* GetHashKeys()
+{
+  struct Keys
+  {
+    uint64_t k[16 * 4 + 4 + 4];
+    Keys()
+    {
+      uint64_t state = 0x46726D5574696C48ULL;
+      for (uint64_t& key : k)
+      {
+        // splitmix64
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        key = z ^ (z >> 31);
+      }
+    }
+  };
+  static const Keys keys;
+  return keys.k;
+}
+
+// Accumulates count stripes starting at stripe index *pStripe within the current block of 16.
+template <bool Masked>
+inline void HashStripes(uint64_t* pAcc, const uint8_t* pData, const uint8_t* pMask, size_t count, int* pStripe)
+{
+  const uint64_t* pKeys = GetHashKeys();
+  const uint64_t* pScramble = &pKeys[16 * 4];
+  int stripe = *pStripe;
+
+#if defined(FRAMEUTIL_AVX2)
+  __m256i acc = _mm256_loadu_si256((const __m256i*)pAcc);
+  const __m256i prime = _mm256_set1_epi64x(HashPrime32);
+  for (size_t s = 0; s < count; s++, pData += 32, pMask += Masked ? 32 : 0)
+  {
+    __m256i data = _mm256_loadu_si256((const __m256i*)pData);
+    if (Masked) data = _mm256_and_si256(data, _mm256_loadu_si256((const __m256i*)pMask));
+    __m256i dataKey = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)&pKeys[stripe * 4]));
+    __m256i product = _mm256_mul_epu32(dataKey, _mm256_srli_epi64(dataKey, 32));
+    acc = _mm256_add_epi64(acc, _mm256_add_epi64(_mm256_shuffle_epi32(data, 0x4e), product));
+
+    if (++stripe == 16)
+    {
+      acc = _mm256_xor_si256(acc, _mm256_srli_epi64(acc, 47));
+      acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*)pScramble));
+      __m256i high = _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(acc, 32), prime), 32);
+      acc = _mm256_add_epi64(_mm256_mul_epu32(acc, prime), high);
+      stripe = 0;
+    }
+  }
+  _mm256_storeu_si256((__m256i*)pAcc, acc);
+#elif defined(FRAMEUTIL_SSE2)
+  __m128i acc[2] = {_mm_loadu_si128((const __m128i*)pAcc), _mm_loadu_si128((const __m128i*)&pAcc[2])};
+  const __m128i prime = _mm_set1_epi32((int)HashPrime32);
+  for (size_t s = 0; s < count; s++, pData += 32, pMask += Masked ? 32 : 0)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      __m128i data = _mm_loadu_si128((const __m128i*)&pData[i * 16]);
+      if (Masked) data = _mm_and_si128(data, _mm_loadu_si128((const __m128i*)&pMask[i * 16]));
+      __m128i dataKey = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)&pKeys[stripe * 4 + i * 2]));
+      __m128i product = _mm_mul_epu32(dataKey, _mm_srli_epi64(dataKey, 32));
+      acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(_mm_shuffle_epi32(data, 0x4e), product));
+    }
+
+    if (++stripe == 16)
+    {
+      for (int i = 0; i < 2; i++)
+      {
+        acc[i] = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+        acc[i] = _mm_xor_si128(acc[i], _mm_loadu_si128((const __m128i*)&pScramble[i * 2]));
+        __m128i high = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(acc[i], 32), prime), 32);
+        acc[i] = _mm_add_epi64(_mm_mul_epu32(acc[i], prime), high);
+      }
+      stripe = 0;
+    }
+  }
+  _mm_storeu_si128((__m128i*)pAcc, acc[0]);
+  _mm_storeu_si128((__m128i*)&pAcc[2], acc[1]);
+#elif defined(FRAMEUTIL_NEON)
+  uint64x2_t acc[2] = {vld1q_u64(pAcc), vld1q_u64(&pAcc[2])};
+  const uint32x2_t prime = vdup_n_u32(HashPrime32);
+  for (size_t s = 0; s < count; s++, pData += 32, pMask += Masked ? 32 : 0)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      uint8x16_t bytes = vld1q_u8(&pData[i * 16]);
+      if (Masked) bytes = vandq_u8(bytes, vld1q_u8(&pMask[i * 16]));
+      uint64x2_t data = vreinterpretq_u64_u8(bytes);
+      uint64x2_t dataKey = veorq_u64(data, vld1q_u64(&pKeys[stripe * 4 + i * 2]));
+      uint64x2_t product = vmull_u32(vmovn_u64(dataKey), vshrn_n_u64(dataKey, 32));
+      acc[i] = vaddq_u64(acc[i], vaddq_u64(vextq_u64(data, data, 1), product));
+    }
+
+    if (++stripe == 16)
+    {
+      for (int i = 0; i < 2; i++)
+      {
+        acc[i] = veorq_u64(acc[i], vshrq_n_u64(acc[i], 47));
+        acc[i] = veorq_u64(acc[i], vld1q_u64(&pScramble[i * 2]));
+        uint64x2_t high = vshlq_n_u64(vmull_u32(vshrn_n_u64(acc[i], 32), prime), 32);
+        acc[i] = vaddq_u64(vmull_u32(vmovn_u64(acc[i]), prime), high);
+      }
+      stripe = 0;
+    }
+  }
+  vst1q_u64(pAcc, acc[0]);
+  vst1q_u64(&pAcc[2], acc[1]);
+#else
+  for (size_t s = 0; s < count; s++, pData += 32, pMask += Masked ? 32 : 0)
+  {
+    uint64_t data[4];
+    for (int i = 0; i < 4; i++)
+    {
+      data[i] = Load64(&pData[i * 8]);
+      if (Masked) data[i] &= Load64(&pMask[i * 8]);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+      uint64_t dataKey = data[i] ^ pKeys[stripe * 4 + i];
+      pAcc[i] += data[i ^ 1] + (dataKey & 0xffffffff) * (dataKey >> 32);
+    }
+
+    if (++stripe == 16)
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        pAcc[i] ^= pAcc[i] >> 47;
+        pAcc[i] ^= pScramble[i];
+        pAcc[i] *= HashPrime32;
+      }
+      stripe = 0;
+    }
+  }
+#endif
+
+  *pStripe = stripe;
+}
+
+}  // namespace Detail
+
+inline void FrameHash::Reset(uint64_t seed)
+{
+  m_acc[0] = seed + Detail::HashPrime1;
+  m_acc[1] = seed ^ Detail::HashPrime2;
+  m_acc[2] = seed - Detail::HashPrime3;
+  m_acc[3] = ~seed;
+  m_bufferLength = 0;
+  m_stripe = 0;
+  m_length = 0;
+}
+
+template <bool Masked>
+inline void FrameHash::UpdateImpl(const uint8_t* pData, const uint8_t* pMask, size_t length)
+{
+  m_length += length;
+
+  if (m_bufferLength > 0)
+  {
+    size_t bytes = (size_t)(32 - m_bufferLength) < length ? 32 - m_bufferLength : length;
+    for (size_t i = 0; i < bytes; i++)
+    {
+      m_buffer[m_bufferLength + i] = Masked ? pData[i] & pMask[i] : pData[i];
+    }
+    m_bufferLength += (int)bytes;
+    pData += bytes;
+    pMask += Masked ? bytes : 0;
+    length -= bytes;
+    if (m_bufferLength < 32) return;
+
+    Detail::HashStripes<false>(m_acc, m_buffer, nullptr, 1, &m_stripe);
+    m_bufferLength = 0;
+  }
+
+  size_t stripes = length / 32;
+  Detail::HashStripes<Masked>(m_acc, pData, pMask, stripes, &m_stripe);
+  pData += stripes * 32;
+  pMask += Masked ? stripes * 32 : 0;
+  length -= stripes * 32;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    m_buffer[i] = Masked ? pData[i] & pMask[i] : pData[i];
+  }
+  m_bufferLength = (int)length;
+}
+
+inline void FrameHash::Update(const uint8_t* pData, size_t length) { UpdateImpl<false>(pData, nullptr, length); }
+
+inline void FrameHash::UpdateMasked(const uint8_t* pData, const uint8_t* pMask, size_t length)
+{
+  UpdateImpl<true>(pData, pMask, length);
+}
+
+inline uint64_t FrameHash::Finish() const
+{
+  uint64_t acc[4] = {m_acc[0], m_acc[1], m_acc[2], m_acc[3]};
+  int stripe = m_stripe;
+
+  // The zero padding of the last stripe is told apart by the length.
+  if (m_bufferLength > 0)
+  {
+    uint8_t last[32] = {};
+    memcpy(last, m_buffer, m_bufferLength);
+    Detail::HashStripes<false>(acc, last, nullptr, 1, &stripe);
+  }
+
+  const uint64_t* pFinal = &Detail::GetHashKeys()[16 * 4 + 4];
+  uint64_t hash = m_length * Detail::HashPrime1;
+  for (int i = 0; i < 4; i++)
+  {
+    uint64_t lane = (acc[i] ^ pFinal[i]) * Detail::HashPrime2;
+    hash ^= lane ^ (lane >> 31);
+    hash = ((hash << 27) | (hash >> 37)) * Detail::HashPrime1 + Detail::HashPrime3;
+  }
+
+  hash ^= hash >> 33;
+  hash *= Detail::HashPrime2;
+  hash ^= hash >> 29;
+  hash *= Detail::HashPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+inline uint64_t FrameHash::Hash(const uint8_t* pData, size_t length, uint64_t seed)
+{
+  FrameHash hash(seed);
+  hash.Update(pData, length);
+  return hash.Finish();
+}
+
+inline uint64_t FrameHash::HashMasked(const uint8_t* pData, const uint8_t* pMask, size_t length, uint64_t seed)
+{
+  FrameHash hash(seed);
+  hash.UpdateMasked(pData, pMask, length);
+  return hash.Finish();
+}
+
+inline uint64_t FrameHash::HashPlanes(const uint8_t* pPlanes, int planeSize, uint8_t bitlen, uint8_t planeMask,
+                                      uint64_t seed)
+{
+  FrameHash hash(seed);
+  for (int i = 0; i < bitlen; i++)
+  {
+    if (planeMask & (1 << i)) hash.Update(&pPlanes[(size_t)i * planeSize], planeSize);
+  }
+  return hash.Finish();
+}
+
+inline FrameCache::FrameCache(int numEntries, size_t frameSize) : m_frameSize(frameSize)
+{
+  m_hashes.resize(numEntries);
+  m_lastUse.resize(numEntries);
+  m_frames.resize((size_t)numEntries * frameSize);
+}
+
+inline const uint8_t* FrameCache::Find(uint64_t hash)
+{
+  for (size_t i = 0; i < m_hashes.size(); i++)
+  {
+    if (m_lastUse[i] != 0 && m_hashes[i] == hash)
+    {
+      m_lastUse[i] = ++m_clock;
+      return &m_frames[i * m_frameSize];
+    }
+  }
+  return nullptr;
+}
+
+inline void FrameCache::Insert(uint64_t hash, const uint8_t* pFrame)
+{
+  if (m_hashes.empty()) return;
+
+  size_t oldest = 0;
+  for (size_t i = 0; i < m_hashes.size(); i++)
+  {
+    if (m_lastUse[i] != 0 && m_hashes[i] == hash)
+    {
+      oldest = i;
+      break;
+    }
+    if (m_lastUse[i] < m_lastUse[oldest]) oldest = i;
+  }
+
+  m_hashes[oldest] = hash;
+  m_lastUse[oldest] = ++m_clock;
+  memcpy(&m_frames[oldest * m_frameSize], pFrame, m_frameSize);
+}
+
+inline void FrameCache::Clear()
+{
+  for (uint64_t& lastUse : m_lastUse)
+  {
+    lastUse = 0;
+  }
+  m_clock = 0;
+}
+
+}  // namespace FrameUtil
@@ -0,0 +1,543 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "FrameHash.h"
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Frames made of planes rather than pixels. Planes is a source holding indexed pixels, the HUB75 subframes are targets
+// built from RGB565 pixels.
+enum class PlaneFormat
+{
+  Planes,     // bit planes as written by Helper::Split()
+  RgbPlanes,  // HUB75 subframes as written by Helper::SplitIntoRgbPlanes()
+  BcmPlanes   // HUB75 subframes as written by Helper::SplitIntoBcmPlanes()
+};
+
+enum class ScaleMode
+{
+  Center,
+  ScaleUp,
+  ScaleDown,
+  ScaleDownPup
+};
+
+// Converts frames from one format and size into another in a single pass. All stages are run row by row, so the
+// intermediate rows stay in the cache instead of going through full frame buffers. The setters size the internal
+// buffers, Process() itself never allocates.
+//
+// Indexed sources are scaled on the palette indices whenever the palette has no duplicate colors, which gives the
+// same result as scaling the RGB frame at a third of the cost. ScaleDown votes like Helper::ScaleDown() for indices
+// as well, without the tie-breaking quirk Helper::ScaleDownIndexed() keeps for compatibility.
+//
+// With SetCacheSize() the pipeline keeps the most recently converted frames by source fingerprint, so a source frame
+// that is repeated skips the whole conversion. Every setter clears the cache.
+//
+// A copy takes over the configuration only, with buffers and cache of its own, so every thread can run its own copy.
+class FramePipeline
+{
+ public:
+  FramePipeline() { Configure(); }
+  FramePipeline(const FramePipeline& other) { *this = other; }
+  FramePipeline& operator=(const FramePipeline& other);
+
+  // Rgba32 sources and Indexed targets of RGB sources aren't supported, Rgba32 targets get an alpha of 0xff.
+  void SetSource(PixelFormat format, uint16_t width, uint16_t height);
+  void SetSource(PlaneFormat format, uint16_t width, uint16_t height, uint8_t bitlen = 2);
+  void SetPalette(const uint8_t* pPalette, int numColors);
+  void SetScaleMode(ScaleMode mode);
+  void SetTarget(PixelFormat format, uint16_t width, uint16_t height);
+  void SetTarget(PlaneFormat format, uint16_t width, uint16_t height);
+  void SetPanelLayout(int numLogicalRows, ColorMatrix colorMatrix = ColorMatrix::Rgb);
+  void SetBcm(int depth, float brightness = 1.0f, bool brightnessCurve = true);
+  void SetCacheSize(int numEntries);
+
+  bool IsValid() const { return m_valid; }
+  int GetSourceSize() const;
+  int GetTargetSize() const;
+
+  bool Process(const uint8_t* pSrcFrame, uint8_t* pDestFrame);
+
+ private:
+  void Configure();
+
+  template <typename T>
+  void Run(const uint8_t* pSrcFrame, uint8_t* pDestFrame);
+  template <typename T>
+  const T* GetSourceRow(const uint8_t* pSrcFrame, int y);
+  template <typename T>
+  void WriteRow(const T* pRow, uint8_t* pDest);
+
+  // Planes sources are Indexed, panel targets Rgb565, as far as the pixel stages are concerned.
+  PixelFormat m_srcFormat = PixelFormat::Indexed;
+  bool m_srcPlanes = false;
+  PlaneFormat m_srcPlaneFormat = PlaneFormat::Planes;
+  int m_srcWidth = 128;
+  int m_srcHeight = 32;
+  int m_bitlen = 2;
+  PixelFormat m_destFormat = PixelFormat::Rgb24;
+  bool m_destPlanes = false;
+  PlaneFormat m_destPlaneFormat = PlaneFormat::RgbPlanes;
+  int m_destWidth = 128;
+  int m_destHeight = 32;
+  ScaleMode m_scaleMode = ScaleMode::Center;
+  int m_numLogicalRows = 16;
+  ColorMatrix m_colorMatrix = ColorMatrix::Rgb;
+  Palette m_palette;
+  bool m_uniquePalette = true;
+  BcmLut m_bcmLut = BcmLut(8);
+
+  // Derived by Configure().
+  bool m_valid = false;
+  int m_workBytes = 1;
+  int m_scaledWidth = 0;
+  int m_scaledHeight = 0;
+  int m_xOffset = 0;
+  int m_yOffset = 0;
+  std::unique_ptr<PanelLayout> m_pPanelLayout;
+  int m_cacheSize = 0;
+  std::unique_ptr<FrameCache> m_pCache;
+
+  // Three source rows for the scale2x neighbourhood, an unpacked planes row, two scaled rows and the RGB565 frame
+  // the panel planes are built from.
+  std::vector<uint8_t> m_arena;
+  uint8_t* m_pSourceRows[3] = {};
+  int m_sourceRowIndex[3] = {-1, -1, -1};
+  uint8_t* m_pJoinRow = nullptr;
+  uint8_t* m_pScaledRows[2] = {};
+  uint16_t* m_pRgb565Frame = nullptr;
+};
+
+namespace Detail
+{
+
+inline void ConvertRow(const uint16_t* pRow, uint8_t* pDest, PixelFormat format, int width)
+{
+  for (int x = 0; x < width; x++)
+  {
+    uint16_t color = pRow[x];
+    int r = color >> 11;
+    int g = (color >> 5) & 0x3f;
+    int b = color & 0x1f;
+    if (format == PixelFormat::Rgb24)
+    {
+      pDest[x * 3] = (uint8_t)((r << 3) | (r >> 2));
+      pDest[x * 3 + 1] = (uint8_t)((g << 2) | (g >> 4));
+      pDest[x * 3 + 2] = (uint8_t)((b << 3) | (b >> 2));
+    }
+    else
+    {
+      pDest[x * 4] = (uint8_t)((r << 3) | (r >> 2));
+      pDest[x * 4 + 1] = (uint8_t)((g << 2) | (g >> 4));
+      pDest[x * 4 + 2] = (uint8_t)((b << 3) | (b >> 2));
+      pDest[x * 4 + 3] = 0xff;
+    }
+  }
+}
+
+inline void ConvertRow(const Pixel24* pRow, uint8_t* pDest, PixelFormat format, int width)
+{
+  if (format == PixelFormat::Rgba32)
+  {
+    for (int x = 0; x < width; x++)
+    {
+      pDest[x * 4] = pRow[x].c[0];
+      pDest[x * 4 + 1] = pRow[x].c[1];
+      pDest[x * 4 + 2] = pRow[x].c[2];
+      pDest[x * 4 + 3] = 0xff;
+    }
+    return;
+  }
+
+  uint16_t* pRgb565 = (uint16_t*)pDest;
+  for (int x = 0; x < width; x++)
+  {
+    pRgb565[x] = (uint16_t)(((pRow[x].c[0] & 0xf8) << 8) | ((pRow[x].c[1] & 0xfc) << 3) | (pRow[x].c[2] >> 3));
+  }
+}
+
+}  // namespace Detail
+
+inline FramePipeline& FramePipeline::operator=(const FramePipeline& other)
+{
+  if (this == &other) return *this;
+
+  m_srcFormat = other.m_srcFormat;
+  m_srcPlanes = other.m_srcPlanes;
+  m_srcPlaneFormat = other.m_srcPlaneFormat;
+  m_srcWidth = other.m_srcWidth;
+  m_srcHeight = other.m_srcHeight;
+  m_bitlen = other.m_bitlen;
+  m_destFormat = other.m_destFormat;
+  m_destPlanes = other.m_destPlanes;
+  m_destPlaneFormat = other.m_destPlaneFormat;
+  m_destWidth = other.m_destWidth;
+  m_destHeight = other.m_destHeight;
+  m_scaleMode = other.m_scaleMode;
+  m_numLogicalRows = other.m_numLogicalRows;
+  m_colorMatrix = other.m_colorMatrix;
+  m_palette = other.m_palette;
+  m_uniquePalette = other.m_uniquePalette;
+  m_bcmLut = other.m_bcmLut;
+  m_cacheSize = other.m_cacheSize;
+  // Keeps the own panel layout and arena if they still fit.
+  Configure();
+  return *this;
+}
+
+inline void FramePipeline::SetSource(PixelFormat format, uint16_t width, uint16_t height)
+{
+  m_srcFormat = format;
+  m_srcPlanes = false;
+  m_srcWidth = width;
+  m_srcHeight = height;
+  Configure();
+}
+
+inline void FramePipeline::SetSource(PlaneFormat format, uint16_t width, uint16_t height, uint8_t bitlen)
+{
+  m_srcFormat = PixelFormat::Indexed;
+  m_srcPlanes = true;
+  m_srcPlaneFormat = format;
+  m_srcWidth = width;
+  m_srcHeight = height;
+  m_bitlen = bitlen > 8 ? 8 : bitlen;
+  Configure();
+}
+
+inline void FramePipeline::SetPalette(const uint8_t* pPalette, int numColors)
+{
+  m_palette.Set(pPalette, numColors);
+
+  m_uniquePalette = true;
+  for (int i = 0; i < numColors && m_uniquePalette; i++)
+  {
+    for (int j = i + 1; j < numColors; j++)
+    {
+      if (memcmp(&pPalette[i * 3], &pPalette[j * 3], 3) == 0)
+      {
+        m_uniquePalette = false;
+        break;
+      }
+    }
+  }
+
+  // Only the working pixel size can change, the arena is already sized for the widest one.
+  Configure();
+}
+
+inline void FramePipeline::SetScaleMode(ScaleMode mode)
+{
+  m_scaleMode = mode;
+  Configure();
+}
+
+inline void FramePipeline::SetTarget(PixelFormat format, uint16_t width, uint16_t height)
+{
+  m_destFormat = format;
+  m_destPlanes = false;
+  m_destWidth = width;
+  m_destHeight = height;
+  Configure();
+}
+
+inline void FramePipeline::SetTarget(PlaneFormat format, uint16_t width, uint16_t height)
+{
+  m_destFormat = PixelFormat::Rgb565;
+  m_destPlanes = true;
+  m_destPlaneFormat = format;
+  m_destWidth = width;
+  m_destHeight = height;
+  Configure();
+}
+
+inline void FramePipeline::SetPanelLayout(int numLogicalRows, ColorMatrix colorMatrix)
+{
+  m_numLogicalRows = numLogicalRows;
+  m_colorMatrix = colorMatrix;
+  Configure();
+}
+
+inline void FramePipeline::SetBcm(int depth, float brightness, bool brightnessCurve)
+{
+  m_bcmLut = BcmLut(depth, brightness, brightnessCurve);
+  // The depth sets the target size, the cache has to follow it.
+  Configure();
+}
+
+inline void FramePipeline::SetCacheSize(int numEntries)
+{
+  m_cacheSize = numEntries;
+  Configure();
+}
+
+inline int FramePipeline::GetSourceSize() const
+{
+  if (m_srcPlanes) return m_srcWidth * m_srcHeight / 8 * m_bitlen;
+  return m_srcWidth * m_srcHeight * FrameView::GetPixelBytes(m_srcFormat);
+}
+
+inline int FramePipeline::GetTargetSize() const
+{
+  if (!m_destPlanes) return m_destWidth * m_destHeight * FrameView::GetPixelBytes(m_destFormat);
+  if (m_destPlaneFormat == PlaneFormat::BcmPlanes) return m_destWidth * m_destHeight / 2 * m_bcmLut.GetDepth();
+  return m_destWidth * m_destHeight / 2 * 3;
+}
+
+inline void FramePipeline::Configure()
+{
+  bool indexedSource = m_srcFormat == PixelFormat::Indexed;
+  bool panelTarget = m_destPlanes;
+
+  m_valid = true;
+  if (m_srcFormat == PixelFormat::Rgba32 || (m_srcPlanes && m_srcPlaneFormat != PlaneFormat::Planes) ||
+      (m_destPlanes && m_destPlaneFormat == PlaneFormat::Planes))
+    m_valid = false;
+  if (!indexedSource && m_destFormat == PixelFormat::Indexed) m_valid = false;
+  if (m_srcPlanes && m_srcWidth % 8 != 0) m_valid = false;
+
+  // Scaling works on indices, or on the source colors otherwise. A palette with duplicate colors forces RGB24, as
+  // scale2x and the downscalers could tell apart indices that share a color.
+  if (indexedSource)
+    m_workBytes = (m_destFormat == PixelFormat::Indexed || m_uniquePalette) ? 1 : 3;
+  else
+    m_workBytes = FrameView::GetPixelBytes(m_srcFormat);
+
+  switch (m_scaleMode)
+  {
+    case ScaleMode::Center:
+      m_scaledWidth = m_srcWidth;
+      m_scaledHeight = m_srcHeight;
+      break;
+    case ScaleMode::ScaleUp:
+      m_scaledWidth = m_srcWidth * 2;
+      m_scaledHeight = m_srcHeight * 2;
+      break;
+    case ScaleMode::ScaleDown:
+    case ScaleMode::ScaleDownPup:
+      m_scaledWidth = m_srcWidth / 2;
+      m_scaledHeight = m_srcHeight / 2;
+      if (m_srcWidth % 2 != 0 || m_srcHeight % 2 != 0) m_valid = false;
+      break;
+  }
+  if (m_scaledWidth > m_destWidth || m_scaledHeight > m_destHeight || m_srcWidth == 0 || m_srcHeight == 0)
+    m_valid = false;
+  m_xOffset = (m_destWidth - m_scaledWidth) / 2;
+  m_yOffset = (m_destHeight - m_scaledHeight) / 2;
+
+  if (panelTarget && m_valid)
+  {
+    if (!m_pPanelLayout || m_pPanelLayout->GetWidth() != m_destWidth || m_pPanelLayout->GetHeight() != m_destHeight ||
+        m_pPanelLayout->GetNumLogicalRows() != m_numLogicalRows || m_pPanelLayout->GetColorMatrix() != m_colorMatrix)
+      m_pPanelLayout.reset(new PanelLayout(m_destWidth, m_destHeight, m_numLogicalRows, m_colorMatrix));
+  }
+  else
+  {
+    m_pPanelLayout.reset();
+  }
+
+  // Every row is sized for 4 bytes per pixel, so a palette change never has to grow the arena.
+  size_t sourceRow = (size_t)m_srcWidth * 4;
+  size_t scaledRow = (size_t)(m_scaledWidth > m_destWidth ? m_scaledWidth : m_destWidth) * 4;
+  size_t rgb565Frame = panelTarget ? (size_t)m_destWidth * m_destHeight * 2 : 0;
+  m_arena.resize(sourceRow * 4 + scaledRow * 2 + rgb565Frame);
+
+  uint8_t* p = m_arena.data();
+  for (int i = 0; i < 3; i++, p += sourceRow)
+  {
+    m_pSourceRows[i] = p;
+  }
+  m_pJoinRow = p;
+  p += sourceRow;
+  m_pScaledRows[0] = p;
+  m_pScaledRows[1] = p + scaledRow;
+  p += scaledRow * 2;
+  m_pRgb565Frame = panelTarget ? (uint16_t*)p : nullptr;
+
+  if (m_cacheSize > 0 && m_valid)
+  {
+    if (!m_pCache || m_pCache->GetNumEntries() != m_cacheSize || m_pCache->GetFrameSize() != (size_t)GetTargetSize())
+      m_pCache.reset(new FrameCache(m_cacheSize, GetTargetSize()));
+    else
+      m_pCache->Clear();
+  }
+  else
+  {
+    m_pCache.reset();
+  }
+}
+
+template <typename T>
+inline const T* FramePipeline::GetSourceRow(const uint8_t* pSrcFrame, int y)
+{
+  if (!m_srcPlanes && (m_srcFormat != PixelFormat::Indexed || sizeof(T) == 1))
+    return (const T*)&pSrcFrame[(size_t)y * m_srcWidth * sizeof(T)];
+
+  // Converted rows live in a ring of three, enough for the rows above and below the current one.
+  int slot = y % 3;
+  uint8_t* pRow = m_pSourceRows[slot];
+  if (m_sourceRowIndex[slot] == y) return (const T*)pRow;
+  m_sourceRowIndex[slot] = y;
+
+  const uint8_t* pIndexed = &pSrcFrame[(size_t)y * m_srcWidth];
+  if (m_srcPlanes)
+  {
+    uint8_t* pJoined = sizeof(T) == 1 ? pRow : m_pJoinRow;
+    int planeSize = m_srcWidth * m_srcHeight / 8;
+    Detail::JoinPlanes(pJoined, &pSrcFrame[y * m_srcWidth / 8], planeSize, m_srcWidth / 8, m_bitlen);
+    pIndexed = pJoined;
+  }
+  if (sizeof(T) == 3) m_palette.ConvertToRgb24(pRow, pIndexed, m_srcWidth);
+
+  return (const T*)pRow;
+}
+
+template <typename T>
+inline void FramePipeline::WriteRow(const T* pRow, uint8_t* pDest)
+{
+  PixelFormat format = m_destFormat;
+
+  if (sizeof(T) == 1 && format != PixelFormat::Indexed)
+  {
+    const uint8_t* pIndexed = (const uint8_t*)pRow;
+    if (format == PixelFormat::Rgb24)
+      m_palette.ConvertToRgb24(pDest, pIndexed, m_scaledWidth);
+    else if (format == PixelFormat::Rgb565)
+      m_palette.ConvertToRgb565((uint16_t*)pDest, pIndexed, m_scaledWidth);
+    else
+      m_palette.ConvertToRgba32(pDest, pIndexed, m_scaledWidth);
+  }
+  else if (FrameView::GetPixelBytes(format) == (int)sizeof(T))
+  {
+    memcpy(pDest, pRow, m_scaledWidth * sizeof(T));
+  }
+  else
+  {
+    Detail::ConvertRow((const typename std::conditional<sizeof(T) == 2, uint16_t, Pixel24>::type*)pRow, pDest, format,
+                       m_scaledWidth);
+  }
+}
+
+template <typename T>
+inline void FramePipeline::Run(const uint8_t* pSrcFrame, uint8_t* pDestFrame)
+{
+  bool panelTarget = m_pRgb565Frame != nullptr;
+  uint8_t* pTarget = panelTarget ? (uint8_t*)m_pRgb565Frame : pDestFrame;
+  int bytes = FrameView::GetPixelBytes(m_destFormat);
+  size_t destRow = (size_t)m_destWidth * bytes;
+  // Scaled rows go straight into the target if no conversion follows.
+  bool direct = (int)sizeof(T) == bytes && (sizeof(T) != 1 || m_destFormat == PixelFormat::Indexed);
+
+  memset(pTarget, 0, destRow * m_yOffset);
+  memset(&pTarget[destRow * (m_yOffset + m_scaledHeight)], 0, destRow * (m_destHeight - m_yOffset - m_scaledHeight));
+  for (int i = 0; i < 3; i++)
+  {
+    m_sourceRowIndex[i] = -1;
+  }
+
+  int rowsPerStep = m_scaleMode == ScaleMode::ScaleUp ? 2 : 1;
+  for (int y = 0; y < m_scaledHeight; y += rowsPerStep)
+  {
+    uint8_t* pDestRows[2];
+    T* pRows[2];
+    for (int i = 0; i < rowsPerStep; i++)
+    {
+      pDestRows[i] = &pTarget[destRow * (m_yOffset + y + i)];
+      memset(pDestRows[i], 0, m_xOffset * bytes);
+      memset(&pDestRows[i][(m_xOffset + m_scaledWidth) * bytes], 0,
+             (m_destWidth - m_xOffset - m_scaledWidth) * bytes);
+      pRows[i] = direct ? (T*)&pDestRows[i][m_xOffset * bytes] : (T*)m_pScaledRows[i];
+    }
+
+    switch (m_scaleMode)
+    {
+      case ScaleMode::Center:
+        memcpy(pRows[0], GetSourceRow<T>(pSrcFrame, y), m_scaledWidth * sizeof(T));
+        break;
+
+      case ScaleMode::ScaleUp:
+      {
+        int srcY = y / 2;
+        const T* pAbove = GetSourceRow<T>(pSrcFrame, srcY > 0 ? srcY - 1 : srcY);
+        const T* pRow = GetSourceRow<T>(pSrcFrame, srcY);
+        const T* pBelow = GetSourceRow<T>(pSrcFrame, srcY < m_srcHeight - 1 ? srcY + 1 : srcY);
+        Detail::ScaleUpRow(pRows[0], pRows[1], pAbove, pRow, pBelow, m_srcWidth);
+        break;
+      }
+
+      case ScaleMode::ScaleDown:
+      {
+        const T* pUpper = GetSourceRow<T>(pSrcFrame, y * 2);
+        const T* pLower = GetSourceRow<T>(pSrcFrame, y * 2 + 1);
+        bool upperHalf = y < (m_scaledHeight + 1) / 2;
+        // Indices and colors take the same vote, so scaling indices can't differ from scaling their colors.
+        Detail::ScaleDownRow<Detail::ScaleDownPolicy::Quadrant>(pRows[0], pUpper, pLower, m_scaledWidth, upperHalf);
+        break;
+      }
+
+      case ScaleMode::ScaleDownPup:
+      {
+        const T* pUpper = GetSourceRow<T>(pSrcFrame, y * 2);
+        const T* pLower = GetSourceRow<T>(pSrcFrame, y * 2 + 1);
+        Detail::ScaleDownRow<Detail::ScaleDownPolicy::Pup>(pRows[0], pUpper, pLower, m_scaledWidth, true);
+        break;
+      }
+    }
+
+    if (!direct)
+    {
+      for (int i = 0; i < rowsPerStep; i++)
+      {
+        WriteRow(pRows[i], &pDestRows[i][m_xOffset * bytes]);
+      }
+    }
+  }
+
+  if (!panelTarget) return;
+  if (m_destPlaneFormat == PlaneFormat::RgbPlanes)
+    Helper::SplitIntoRgbPlanes(m_pRgb565Frame, *m_pPanelLayout, pDestFrame);
+  else
+    Helper::SplitIntoBcmPlanes(m_pRgb565Frame, *m_pPanelLayout, m_bcmLut, pDestFrame);
+}
+
+inline bool FramePipeline::Process(const uint8_t* pSrcFrame, uint8_t* pDestFrame)
+{
+  if (!m_valid) return false;
+
+  uint64_t hash = 0;
+  if (m_pCache)
+  {
+    hash = FrameHash::Hash(pSrcFrame, GetSourceSize());
+    const uint8_t* pCached = m_pCache->Find(hash);
+    if (pCached)
+    {
+      memcpy(pDestFrame, pCached, GetTargetSize());
+      return true;
+    }
+  }
+
+  switch (m_workBytes)
+  {
+    case 1:
+      Run<uint8_t>(pSrcFrame, pDestFrame);
+      break;
+    case 2:
+      Run<uint16_t>(pSrcFrame, pDestFrame);
+      break;
+    case 3:
+      Run<Pixel24>(pSrcFrame, pDestFrame);
+      break;
+    default:
+      return false;
+  }
+
+  if (m_pCache) m_pCache->Insert(hash, pDestFrame);
+  return true;
+}
+
+}  // namespace FrameUtil
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+
+// Maps RGB frames onto the nearest colors of a palette of up to 256 colors, the way back from Palette. The nearest
+// entry of every RGB565 color is kept in a table of 64K indices, so a pixel costs one table load instead of a search.
+// RGB24 and RGBA32 pixels are reduced to RGB565 first, alpha is ignored.
+//
+// Set() only compares the palette, the table is rebuilt on the next conversion and only if the palette changed.
+class FrameQuantizer
+{
+ public:
+  FrameQuantizer() = default;
+  FrameQuantizer(const uint8_t* pPalette, int numColors) { Set(pPalette, numColors); }
+
+  void Set(const uint8_t* pPalette, int numColors);
+  int GetNumColors() const { return m_numColors; }
+
+  // Index of the palette color closest to the RGB565 color, the lowest index among equally close ones. 0 without a
+  // palette.
+  uint8_t GetIndex(uint16_t rgb565)
+  {
+    if (m_dirty) Build();
+    return m_table[rgb565];
+  }
+
+  void ConvertFromRgb24(uint8_t* pFrame, const uint8_t* pFrameRgb24, int size);
+  void ConvertFromRgb565(uint8_t* pFrame, const uint16_t* pFrameRgb565, int size);
+  void ConvertFromRgba32(uint8_t* pFrame, const uint8_t* pFrameRgba32, int size);
+  // Converts an Rgb24, Rgb565 or Rgba32 view into an indexed one of the same size.
+  void Convert(const FrameView& dest, const FrameView& src);
+
+ private:
+  void Build();
+
+  int m_numColors = 0;
+  uint8_t m_source[256 * 3];
+  bool m_dirty = true;
+  std::vector<uint8_t> m_table;
+};
+
+inline void FrameQuantizer::Set(const uint8_t* pPalette, int numColors)
+{
+  numColors = numColors < 0 ? 0 : (numColors > 256 ? 256 : numColors);
+  if (numColors == m_numColors && (numColors == 0 || memcmp(m_source, pPalette, numColors * 3) == 0)) return;
+
+  m_numColors = numColors;
+  if (numColors > 0) memcpy(m_source, pPalette, numColors * 3);
+  m_dirty = true;
+}
+
+inline void FrameQuantizer::Build()
+{
+  m_table.assign(65536, 0);
+  m_dirty = false;
+  if (m_numColors == 0) return;
+
+  struct Entry
+  {
+    int r;
+    int g;
+    int b;
+    int index;
+  };
+
+  // Ordered by green, the channel RGB565 resolves best. Searching outwards from the closest green can stop as soon as
+  // green alone is further away than the best match so far.
+  std::vector<Entry> entries(m_numColors);
+  for (int i = 0; i < m_numColors; i++)
+  {
+    entries[i] = {m_source[i * 3], m_source[i * 3 + 1], m_source[i * 3 + 2], i};
+  }
+  std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.g < b.g; });
+  const int numEntries = (int)entries.size();
+
+  for (int g6 = 0; g6 < 64; g6++)
+  {
+    // Cells stand for the color their RGB565 value expands to.
+    int g = (g6 << 2) | (g6 >> 4);
+    int start = 0;
+    while (start < numEntries && entries[start].g < g) start++;
+
+    for (int r5 = 0; r5 < 32; r5++)
+    {
+      int r = (r5 << 3) | (r5 >> 2);
+      for (int b5 = 0; b5 < 32; b5++)
+      {
+        int b = (b5 << 3) | (b5 >> 2);
+        int best = INT_MAX;
+        int bestIndex = 0;
+        auto consider = [&](const Entry& entry)
+        {
+          int dg = entry.g - g;
+          if (dg * dg > best) return false;
+          int dr = entry.r - r;
+          int db = entry.b - b;
+          int distance = dr * dr + dg * dg + db * db;
+          if (distance < best || (distance == best && entry.index < bestIndex))
+          {
+            best = distance;
+            bestIndex = entry.index;
+          }
+          return true;
+        };
+
+        for (int k = start; k < numEntries; k++)
+        {
+          if (!consider(entries[k])) break;
+        }
+        for (int k = start - 1; k >= 0; k--)
+        {
+          if (!consider(entries[k])) break;
+        }
+        m_table[r5 << 11 | g6 << 5 | b5] = (uint8_t)bestIndex;
+      }
+    }
+  }
+}
+
+inline void FrameQuantizer::ConvertFromRgb24(uint8_t* pFrame, const uint8_t* pFrameRgb24, int size)
+{
+  if (m_dirty) Build();
+  const uint8_t* pTable = m_table.data();
+  for (int i = 0; i < size; i++)
+  {
+    const uint8_t* pColor = &pFrameRgb24[i * 3];
+    pFrame[i] = pTable[((pColor[0] & 0xf8) << 8) | ((pColor[1] & 0xfc) << 3) | (pColor[2] >> 3)];
+  }
+}
+
+inline void FrameQuantizer::ConvertFromRgb565(uint8_t* pFrame, const uint16_t* pFrameRgb565, int size)
+{
+  if (m_dirty) Build();
+  const uint8_t* pTable = m_table.data();
+  for (int i = 0; i < size; i++)
+  {
+    pFrame[i] = pTable[pFrameRgb565[i]];
+  }
+}
+
+inline void FrameQuantizer::ConvertFromRgba32(uint8_t* pFrame, const uint8_t* pFrameRgba32, int size)
+{
+  if (m_dirty) Build();
+  const uint8_t* pTable = m_table.data();
+  for (int i = 0; i < size; i++)
+  {
+    const uint8_t* pColor = &pFrameRgba32[i * 4];
+    pFrame[i] = pTable[((pColor[0] & 0xf8) << 8) | ((pColor[1] & 0xfc) << 3) | (pColor[2] >> 3)];
+  }
+}
+
+inline void FrameQuantizer::Convert(const FrameView& dest, const FrameView& src)
+{
+  if (dest.GetFormat() != PixelFormat::Indexed || dest.GetWidth() < src.GetWidth() ||
+      dest.GetHeight() < src.GetHeight())
+    return;
+
+  // Packed frames of the same width are converted in one go.
+  bool packed = src.IsPacked() && dest.IsPacked() && dest.GetWidth() == src.GetWidth();
+  int width = packed ? src.GetWidth() * src.GetHeight() : src.GetWidth();
+  int height = packed ? 1 : src.GetHeight();
+
+  for (int y = 0; y < height; y++)
+  {
+    switch (src.GetFormat())
+    {
+      case PixelFormat::Rgb565:
+        ConvertFromRgb565(dest.GetRow(y), (const uint16_t*)src.GetRow(y), width);
+        break;
+      case PixelFormat::Rgb24:
+        ConvertFromRgb24(dest.GetRow(y), src.GetRow(y), width);
+        break;
+      case PixelFormat::Rgba32:
+        ConvertFromRgba32(dest.GetRow(y), src.GetRow(y), width);
+        break;
+      default:
+        return;
+    }
+  }
+}
+
+}  // namespace FrameUtil
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Call counters, bytes and latency histograms for the Helper entry points, compiled in with FRAMEUTIL_STATS only.
+// Without it the scope macros expand to nothing and not even their arguments are evaluated. Stats itself is always
+// available, so code exporting the numbers builds either way and just sees no counters.
+//
+// Callers can time their own stages the same way:
+//
+//   FRAMEUTIL_STATS_SCOPE("display.render", width * height * 3);
+//
+// The kernel builds of the library never record, only the Helper calls compiled into the user's code do.
+#if defined(FRAMEUTIL_STATS) && !defined(FRAMEUTIL_ISA_NAMESPACE)
+#define FRAMEUTIL_USE_STATS
+#endif
+
+#define _FRAMEUTIL_STATS_CONCAT(a, b) a##b
+#define FRAMEUTIL_STATS_CONCAT(a, b) _FRAMEUTIL_STATS_CONCAT(a, b)
+
+#if defined(FRAMEUTIL_USE_STATS)
+#define _FRAMEUTIL_STATS_SCOPE(name, bytes, outermostOnly, counter)  \
+  static const int counter = ::FrameUtil::Stats::Register(name); \
+  ::FrameUtil::StatsScope FRAMEUTIL_STATS_CONCAT(counter, Scope)(counter, (uint64_t)(bytes), outermostOnly)
+#define FRAMEUTIL_STATS_SCOPE(name, bytes) \
+  _FRAMEUTIL_STATS_SCOPE(name, bytes, false, FRAMEUTIL_STATS_CONCAT(statsCounter, __LINE__))
+// Only the outermost Helper call on a thread records, so overloads forwarding to each other count once.
+#define FRAMEUTIL_HELPER_SCOPE(name, bytes) \
+  _FRAMEUTIL_STATS_SCOPE(name, bytes, true, FRAMEUTIL_STATS_CONCAT(statsCounter, __LINE__))
+#else
+#define FRAMEUTIL_STATS_SCOPE(name, bytes) ((void)0)
+#define FRAMEUTIL_HELPER_SCOPE(name, bytes) ((void)0)
+#endif
+
+namespace FrameUtil
+{
+
+class Stats
+{
+ public:
+  static constexpr int MaxCounters = 64;
+  // Bucket i counts calls that took less than 2^i ns and at least half of that, the last one everything above.
+  static constexpr int HistogramBuckets = 32;
+
+  struct Counter
+  {
+    std::string name;
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint64_t histogram[HistogramBuckets];
+
+    uint64_t GetAverageNs() const { return calls > 0 ? totalNs / calls : 0; }
+    // Upper bound of the bucket holding the given fraction of calls, e.g. 0.99 for the 99th percentile.
+    uint64_t GetPercentileNs(double fraction) const;
+  };
+
+  // Returns the counter of that name, creating it on first use, or -1 once MaxCounters are taken.
+  static int Register(const char* pName);
+  static void Record(int counter, uint64_t bytes, uint64_t ns);
+
+  // Counters that recorded nothing since the last Reset() are left out.
+  static std::vector<Counter> GetSnapshot();
+  static void Reset();
+
+ private:
+  struct Slot
+  {
+    char name[64];
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> histogram[HistogramBuckets];
+  };
+
+  struct Registry
+  {
+    std::mutex mutex;
+    int count = 0;
+    Slot slots[MaxCounters];
+  };
+
+  static Registry& GetRegistry();
+};
+
+// Times its own lifetime and records it on the given counter.
+class StatsScope
+{
+ public:
+  StatsScope(int counter, uint64_t bytes, bool outermostOnly = false);
+  ~StatsScope();
+
+  StatsScope(const StatsScope&) = delete;
+  StatsScope& operator=(const StatsScope&) = delete;
+
+ private:
+  static int& GetDepth();
+
+  int m_counter;
+  uint64_t m_bytes;
+  bool m_outermostOnly;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+inline uint64_t Stats::Counter::GetPercentileNs(double fraction) const
+{
+  uint64_t target = (uint64_t)(calls * fraction + 0.5);
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < HistogramBuckets; bucket++)
+  {
+    seen += histogram[bucket];
+    if (seen >= target && seen > 0) return bucket < HistogramBuckets - 1 ? 1ULL << bucket : maxNs;
+  }
+  return maxNs;
+}
+
+inline Stats::Registry& Stats::GetRegistry()
+{
+  // Never destroyed, scopes of static objects may still record during shutdown.
+  static Registry* pRegistry = new Registry();
+  return *pRegistry;
+}
+
+inline int Stats::Register(const char* pName)
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  for (int i = 0; i < registry.count; i++)
+  {
+    if (strncmp(registry.slots[i].name, pName, sizeof(registry.slots[i].name) - 1) == 0) return i;
+  }
+  if (registry.count == MaxCounters) return -1;
+
+  Slot& slot = registry.slots[registry.count];
+  strncpy(slot.name, pName, sizeof(slot.name) - 1);
+  slot.name[sizeof(slot.name) - 1] = '\0';
+  return registry.count++;
+}
+
+inline void Stats::Record(int counter, uint64_t bytes, uint64_t ns)
+{
+  if (counter < 0) return;
+  Slot& slot = GetRegistry().slots[counter];
+
+  int bucket = 0;
+  while (bucket < HistogramBuckets - 1 && (ns >> bucket) != 0) bucket++;
+
+  slot.calls.fetch_add(1, std::memory_order_relaxed);
+  slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+  slot.totalNs.fetch_add(ns, std::memory_order_relaxed);
+  slot.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max = slot.maxNs.load(std::memory_order_relaxed);
+  while (ns > max && !slot.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+  {
+  }
+}
+
+inline std::vector<Stats::Counter> Stats::GetSnapshot()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  std::vector<Counter> snapshot;
+  for (int i = 0; i < registry.count; i++)
+  {
+    const Slot& slot = registry.slots[i];
+    Counter counter;
+    counter.name = slot.name;
+    counter.calls = slot.calls.load(std::memory_order_relaxed);
+    if (counter.calls == 0) continue;
+    counter.bytes = slot.bytes.load(std::memory_order_relaxed);
+    counter.totalNs = slot.totalNs.load(std::memory_order_relaxed);
+    counter.maxNs = slot.maxNs.load(std::memory_order_relaxed);
+    for (int bucket = 0; bucket < HistogramBuckets; bucket++)
+    {
+      counter.histogram[bucket] = slot.histogram[bucket].load(std::memory_order_relaxed);
+    }
+    snapshot.push_back(counter);
+  }
+  return snapshot;
+}
+
+inline void Stats::Reset()
+{
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  for (int i = 0; i < registry.count; i++)
+  {
+    Slot& slot = registry.slots[i];
+    slot.calls.store(0, std::memory_order_relaxed);
+    slot.bytes.store(0, std::memory_order_relaxed);
+    slot.totalNs.store(0, std::memory_order_relaxed);
+    slot.maxNs.store(0, std::memory_order_relaxed);
+    for (auto& bucket : slot.histogram) bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+inline int& StatsScope::GetDepth()
+{
+  static thread_local int depth = 0;
+  return depth;
+}
+
+inline StatsScope::StatsScope(int counter, uint64_t bytes, bool outermostOnly)
+    : m_counter(counter), m_bytes(bytes), m_outermostOnly(outermostOnly)
+{
+  if (m_outermostOnly && GetDepth()++ > 0) m_counter = -1;
+  if (m_counter >= 0) m_start = std::chrono::steady_clock::now();
+}
+
+inline StatsScope::~StatsScope()
+{
+  if (m_outermostOnly) GetDepth()--;
+  if (m_counter < 0) return;
+
+  auto elapsed = std::chrono::steady_clock::now() - m_start;
+  Stats::Record(m_counter, m_bytes, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+}  // namespace FrameUtil
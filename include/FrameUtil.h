@@ -20,30 +20,260 @@
   "." FRAMEUTIL_STR(FRAMEUTIL_VERSION_MINOR) "." FRAMEUTIL_STR(FRAMEUTIL_VERSION_PATCH)
 #define FRAMEUTIL_MINOR_VERSION FRAMEUTIL_STR(FRAMEUTIL_VERSION_MAJOR) "." FRAMEUTIL_STR(FRAMEUTIL_VERSION_MINOR)
 
+#include <atomic>
 #include <cstdint>
 #include <cstring>
-#include <iomanip>
-#include <sstream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include "FrameStats.h"
+
+// SIMD kernels are selected from the compiler's target flags. Define FRAMEUTIL_NO_SIMD to force the portable
+// 64-bit SWAR paths, e.g. to validate them on a machine that would otherwise take a vector path. The per-ISA kernel
+// builds of the library enable AVX2 or NEON for their own code only and announce it with FRAMEUTIL_FORCE_AVX2 or
+// FRAMEUTIL_FORCE_NEON.
+#if !defined(FRAMEUTIL_NO_SIMD)
+#if defined(__AVX2__) || defined(FRAMEUTIL_FORCE_AVX2)
+#define FRAMEUTIL_AVX2
+#endif
+#if defined(__SSSE3__) || defined(FRAMEUTIL_AVX2)
+#define FRAMEUTIL_SSSE3
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(FRAMEUTIL_AVX2)
+#define FRAMEUTIL_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64) || defined(FRAMEUTIL_FORCE_NEON)
+#define FRAMEUTIL_NEON
+#endif
+#endif
+
+// The compiled library defines FRAMEUTIL_DISPATCH for itself and its users. The Helper entry points then call the
+// kernel build picked for the running CPU, while the per-ISA builds compile this header into their own namespace.
+#if defined(FRAMEUTIL_DISPATCH) && !defined(FRAMEUTIL_ISA_NAMESPACE)
+#define FRAMEUTIL_USE_DISPATCH
+#endif
+
+#if defined(FRAMEUTIL_AVX2)
+#include <immintrin.h>
+#elif defined(FRAMEUTIL_SSSE3)
+#include <tmmintrin.h>
+#elif defined(FRAMEUTIL_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(FRAMEUTIL_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace FrameUtil
 {
 
+#if defined(FRAMEUTIL_DISPATCH) || defined(FRAMEUTIL_ISA_NAMESPACE)
+namespace Dispatch
+{
+
+// Entry points of one kernel build. Only plain types cross the table, as every build has its own copy of the classes.
+struct Kernels
+{
+  const char* name;
+  void (*convertToRgb24)(uint8_t* pFrameRgb24, uint8_t* pFrame, int size, uint8_t* pPalette);
+  void (*split)(uint8_t* pPlanes, uint16_t width, uint16_t height, uint8_t bitlen, uint8_t* pFrame);
+  void (*join)(uint8_t* pFrame, uint16_t width, uint16_t height, uint8_t bitlen, const uint8_t* pPlanes);
+  void (*splitIntoRgbPlanes)(const uint16_t* rgb565, int rgb565Size, int width, int numLogicalRows, uint8_t* dest,
+                             int colorMatrix);
+  void (*scaleDownIndexed)(uint8_t* pDestFrame, uint16_t destWidth, uint8_t destHeight, const uint8_t* pSrcFrame,
+                           uint16_t srcWidth, uint8_t srcHeight);
+  void (*scaleDownPup)(uint8_t* pDestFrame, uint16_t destWidth, uint8_t destHeight, const uint8_t* pSrcFrame,
+                       uint16_t srcWidth, uint8_t srcHeight);
+  void (*scaleDown)(uint8_t* pDestFrame, uint16_t destWidth, uint16_t destHeight, const uint8_t* pSrcFrame,
+                    uint16_t srcWidth, uint16_t srcHeight, uint8_t bits);
+  void (*scaleUp)(uint8_t* pDestFrame, const uint8_t* pSrcFrame, uint16_t srcWidth, uint16_t srcHeight, uint8_t bits);
+};
+
+// Picks the best build for the CPU on first use. The environment variable FRAMEUTIL_ISA set to scalar, sse2, avx2 or
+// neon forces that build if the CPU supports it.
+const Kernels& GetKernels();
+
+}  // namespace Dispatch
+#endif
+
+#if defined(FRAMEUTIL_ISA_NAMESPACE)
+namespace FRAMEUTIL_ISA_NAMESPACE
+{
+#endif
+
 enum class ColorMatrix
 {
   Rgb,
   Rbg
 };
 
+// Destination permutation of Helper::SplitIntoRgbPlanes() for one panel configuration. Building it runs
+// MapAdafruitIndex() once per dot pair, afterwards every frame is emitted in linear output order.
+class PanelLayout
+{
+ public:
+  // A stretch of consecutive dot pairs whose upper pixels are consecutive in the source frame as well.
+  struct Run
+  {
+    int dest;
+    int src;
+    int length;
+  };
+
+  PanelLayout(int width, int height, int numLogicalRows, ColorMatrix colorMatrix = ColorMatrix::Rgb);
+
+  int GetWidth() const { return m_width; }
+  int GetHeight() const { return m_height; }
+  int GetNumLogicalRows() const { return m_numLogicalRows; }
+  ColorMatrix GetColorMatrix() const { return m_colorMatrix; }
+  int GetSubframeSize() const { return m_width * m_height / 2; }
+  const std::vector<Run>& GetRuns() const { return m_runs; }
+
+ private:
+  int m_width;
+  int m_height;
+  int m_numLogicalRows;
+  ColorMatrix m_colorMatrix;
+  std::vector<Run> m_runs;
+};
+
+// Packed RGB24 pixel for the pixel-typed kernels of Helper.
+struct Pixel24
+{
+  uint8_t c[3];
+};
+
+inline bool operator==(const Pixel24& a, const Pixel24& b)
+{
+  return a.c[0] == b.c[0] && a.c[1] == b.c[1] && a.c[2] == b.c[2];
+}
+
+enum class PixelFormat
+{
+  Indexed,  // one palette index per byte
+  Rgb565,   // native endian uint16_t per pixel
+  Rgb24,    // three bytes per pixel
+  Rgba32    // four bytes per pixel
+};
+
+// Non-owning view of a frame whose rows are `stride` bytes apart. Cropping and centering only move the view, so for
+// example a scaler can write straight into the centered part of a larger frame instead of going through a copy.
+class FrameView
+{
+ public:
+  FrameView() {}
+  // A stride of 0 means tightly packed rows.
+  FrameView(uint8_t* pData, int width, int height, PixelFormat format, int stride = 0);
+
+  uint8_t* GetData() const { return m_pData; }
+  int GetWidth() const { return m_width; }
+  int GetHeight() const { return m_height; }
+  int GetStride() const { return m_stride; }
+  PixelFormat GetFormat() const { return m_format; }
+  int GetPixelBytes() const { return GetPixelBytes(m_format); }
+  bool IsPacked() const { return m_stride == m_width * GetPixelBytes(); }
+  uint8_t* GetRow(int y) const { return m_pData + (ptrdiff_t)y * m_stride; }
+
+  // Both are clipped to this view.
+  FrameView Crop(int x, int y, int width, int height) const;
+  FrameView Center(int width, int height) const;
+  void Clear() const;
+
+  static int GetPixelBytes(PixelFormat format);
+
+ private:
+  uint8_t* m_pData = nullptr;
+  int m_width = 0;
+  int m_height = 0;
+  int m_stride = 0;
+  PixelFormat m_format = PixelFormat::Indexed;
+};
+
+// Frame with tightly packed rows that owns its pixels.
+class FrameBuffer
+{
+ public:
+  FrameBuffer(int width, int height, PixelFormat format);
+
+  uint8_t* GetData() { return m_data.data(); }
+  size_t GetSize() const { return m_data.size(); }
+  FrameView GetView() { return FrameView(m_data.data(), m_width, m_height, m_format); }
+
+ private:
+  int m_width;
+  int m_height;
+  PixelFormat m_format;
+  std::vector<uint8_t> m_data;
+};
+
+// Color curve for SplitIntoBcmPlanes(). Every RGB565 channel value is widened to 8 bits, optionally passed through
+// Helper::CalcBrightness(), scaled by brightness and reduced to the top `depth` bits. Each entry is stored with bit n
+// of that value spread into byte n, so building the dot pairs for all planes costs the same for every depth.
+class BcmLut
+{
+ public:
+  BcmLut(int depth, float brightness = 1.0f, bool brightnessCurve = true);
+
+  int GetDepth() const { return m_depth; }
+  uint64_t GetRed(int value) const { return m_red[value]; }
+  uint64_t GetGreen(int value) const { return m_green[value]; }
+  uint64_t GetBlue(int value) const { return m_blue[value]; }
+
+ private:
+  int m_depth;
+  uint64_t m_red[32];
+  uint64_t m_green[64];
+  uint64_t m_blue[32];
+};
+
+// Expanded lookup tables for one RGB24 palette of up to 256 colors. Set() rebuilds them only when the palette really
+// changed, every frame can then be expanded to RGB24, RGB565 or RGBA32 directly. Palettes of up to 16 colors are
+// looked up with byte shuffles, larger ones with gathers where available. Indices beyond the palette turn (transparent)
+// black.
+class Palette
+{
+ public:
+  Palette() { Set(nullptr, 0); }
+  Palette(const uint8_t* pPalette, int numColors) { Set(pPalette, numColors); }
+
+  void Set(const uint8_t* pPalette, int numColors);
+  int GetNumColors() const { return m_numColors; }
+
+  void ConvertToRgb24(uint8_t* pFrameRgb24, const uint8_t* pFrame, int size) const;
+  void ConvertToRgb565(uint16_t* pFrameRgb565, const uint8_t* pFrame, int size) const;
+  void ConvertToRgba32(uint8_t* pFrameRgba32, const uint8_t* pFrame, int size) const;
+  // Converts an indexed view into an Rgb24, Rgb565 or Rgba32 one of the same size.
+  void Convert(const FrameView& dest, const FrameView& src) const;
+
+ private:
+  int m_numColors = -1;
+  uint8_t m_source[256 * 3];
+  alignas(16) uint8_t m_red[256];
+  alignas(16) uint8_t m_green[256];
+  alignas(16) uint8_t m_blue[256];
+  alignas(16) uint8_t m_alpha[256];
+  // Split into bytes for the shuffle lookups, one extra entry keeps the 32-bit gathers inside the table.
+  alignas(16) uint8_t m_rgb565Low[256];
+  alignas(16) uint8_t m_rgb565High[256];
+  uint16_t m_rgb565[257];
+  uint32_t m_rgba[256];
+};
+
 class Helper
 {
  public:
   static int MapAdafruitIndex(int x, int y, int width, int height, int numLogicalRows);
+  // Expands through Palette and reads only the palette entries up to the highest index in the frame. Palette itself
+  // saves the scan for that index and converts to Rgb565 and Rgba32 as well.
   static void ConvertToRgb24(uint8_t* pFrameRgb24, uint8_t* pFrame, int size, uint8_t* pPalette);
   static void Split(uint8_t* pPlanes, uint16_t width, uint16_t height, uint8_t bitlen, uint8_t* pFrame);
+  static void Join(uint8_t* pFrame, uint16_t width, uint16_t height, uint8_t bitlen, const uint8_t* pPlanes);
   static void SplitIntoRgbPlanes(const uint16_t* rgb565, int rgb565Size, int width, int numLogicalRows, uint8_t* dest,
                                  ColorMatrix colorMatrix = ColorMatrix::Rgb);
+  static void SplitIntoRgbPlanes(const uint16_t* rgb565, const PanelLayout& layout, uint8_t* dest);
+  static void SplitIntoBcmPlanes(const uint16_t* rgb565, const PanelLayout& layout, const BcmLut& lut, uint8_t* dest);
   static float CalcBrightness(float x);
   static void ScaleDownIndexed(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
                                const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight);
@@ -51,487 +281,1881 @@ class Helper
                            const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight);
   static void ScaleDown(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
                         const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight, uint8_t bits);
+  template <typename T>
+  static void ScaleDown(T* pDestFrame, const uint16_t destWidth, const uint16_t destHeight, const T* pSrcFrame,
+                        const uint16_t srcWidth, const uint16_t srcHeight);
   static void ScaleUpIndexed(uint8_t* pDestFrame, const uint8_t* pSrcFrame, const uint16_t srcWidth,
                              const uint8_t srcHeight);
   static void ScaleUp(uint8_t* pDestFrame, const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight,
                       uint8_t bits);
+  template <typename T>
+  static void ScaleUp(T* pDestFrame, const T* pSrcFrame, const uint16_t srcWidth, const uint16_t srcHeight);
   static void CenterIndexed(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
                             const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight);
   static void Center(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight, const uint8_t* pSrcFrame,
                      const uint16_t srcWidth, const uint8_t srcHeight, uint8_t bits);
+
+  // Overloads for strided views. Source and destination need the same pixel format, anything else is ignored. The
+  // scalers fill the top left of dest, use FrameView::Center() to place the result.
+  static void ConvertToRgb24(const FrameView& dest, const FrameView& src, const uint8_t* pPalette);
+  static void Split(uint8_t* pPlanes, uint8_t bitlen, const FrameView& src);
+  static void Join(const FrameView& dest, uint8_t bitlen, const uint8_t* pPlanes);
+  static void ScaleDown(const FrameView& dest, const FrameView& src);
+  static void ScaleDownPUP(const FrameView& dest, const FrameView& src);
+  static void ScaleUp(const FrameView& dest, const FrameView& src);
+  static void Copy(const FrameView& dest, const FrameView& src);
+  // Clears the border of dest and copies src into its center, cropping src if it is the larger one.
+  static void Center(const FrameView& dest, const FrameView& src);
 };
 
-inline int Helper::MapAdafruitIndex(int x, int y, int width, int height, int numLogicalRows)
+// Frame operations for a resolution fixed at compile time. Every offset and plane size is a constant, so the kernels
+// are instantiated without any size arithmetic. The runtime-size functions of Helper dispatch here for the standard
+// DMD sizes 128x32, 192x64 and 256x64 and their 2x versions 384x128 and 512x128.
+template <int Width, int Height>
+class FixedFrame
 {
-  int logicalRowLengthPerMatrix = 32 * 32 / 2 / numLogicalRows;
-  int logicalRow = y % numLogicalRows;
-  int dotPairsPerLogicalRow = width * height / numLogicalRows / 2;
-  int widthInMatrices = width / 32;
-  int matrixX = x / 32;
-  int matrixY = y / 32;
-  int totalMatrices = width * height / 1024;
-  int matrixNumber = totalMatrices - ((matrixY + 1) * widthInMatrices) + matrixX;
-  int indexWithinMatrixRow = x % logicalRowLengthPerMatrix;
-  int index = logicalRow * dotPairsPerLogicalRow + matrixNumber * logicalRowLengthPerMatrix + indexWithinMatrixRow;
-  return index;
+ public:
+  static constexpr int PixelCount = Width * Height;
+  static constexpr int PlaneSize = PixelCount / 8;
+  static constexpr int SubframeSize = PixelCount / 2;
+
+  static void Split(uint8_t* pPlanes, uint8_t bitlen, const uint8_t* pFrame);
+  static void Join(uint8_t* pFrame, uint8_t bitlen, const uint8_t* pPlanes);
+  template <typename T>
+  static void ScaleUp(T* pDestFrame, const T* pSrcFrame);
+  // The downscalers write a tightly packed Width / 2 x Height / 2 frame.
+  template <typename T>
+  static void ScaleDown(T* pDestFrame, const T* pSrcFrame);
+  static void ScaleDownIndexed(uint8_t* pDestFrame, const uint8_t* pSrcFrame);
+  static void ScaleDownPUP(uint8_t* pDestFrame, const uint8_t* pSrcFrame);
+  // Built on first use for every configuration and kept for the lifetime of the program, later lookups take no lock.
+  static const PanelLayout& GetPanelLayout(int numLogicalRows, ColorMatrix colorMatrix = ColorMatrix::Rgb);
+};
+
+namespace Detail
+{
+
+// Loads 8 pixels so that pixel n ends up in byte n (counted from the least significant byte).
+inline uint64_t Load64(const uint8_t* p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
 }
 
-inline void Helper::Split(uint8_t* pPlanes, uint16_t width, uint16_t height, uint8_t bitlen, uint8_t* pFrame)
+// Packs bit `plane` of 8 consecutive pixels into one byte, pixel n going to bit n.
+inline uint8_t PackPlane64(uint64_t pixels, int plane)
 {
-  int planeSize = width * height / 8;
+  // The multiplication gathers bit 0 of every byte into the top byte without carries.
+  return (uint8_t)((((pixels >> plane) & 0x0101010101010101ULL) * 0x0102040810204080ULL) >> 56);
+}
+
+// Bit-plane transpose for frames whose width is a multiple of 8, so groups of 8 pixels are contiguous. Each of the
+// `groups` groups becomes one byte in each of the planes, which are planeSize bytes apart. Bits > 0 fixes the plane
+// count at compile time.
+template <int Bits>
+inline void SplitPlanes(uint8_t* pPlanes, const uint8_t* pFrame, int planeSize, int groups, int bitlen)
+{
+  const int planes = Bits > 0 ? Bits : bitlen;
   int pos = 0;
-  uint8_t* bd = (uint8_t*)malloc(bitlen);
 
-  for (int y = 0; y < height; y++)
+#if defined(FRAMEUTIL_AVX2)
+  const __m128i avx2Shift = _mm_cvtsi32_si128(8 - planes);
+  for (; pos + 4 <= groups; pos += 4)
   {
-    for (int x = 0; x < width; x += 8)
+    // Move the highest plane bit into the sign bit, then walk down one plane per doubling.
+    __m256i v = _mm256_sll_epi16(_mm256_loadu_si256((const __m256i*)&pFrame[pos * 8]), avx2Shift);
+    for (int i = planes - 1; i >= 0; i--)
     {
-      memset(bd, 0, bitlen * sizeof(uint8_t));
-
-      for (int v = 7; v >= 0; v--)
-      {
-        uint8_t pixel = pFrame[(y * width) + (x + v)];
-        for (int i = 0; i < bitlen; i++)
-        {
-          bd[i] <<= 1;
-          if ((pixel & (1 << i)) != 0)
-          {
-            bd[i] |= 1;
-          }
-        }
-      }
-
-      for (int i = 0; i < bitlen; i++)
-      {
-        pPlanes[i * planeSize + pos] = bd[i];
-      }
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(v);
+      memcpy(&pPlanes[i * planeSize + pos], &mask, 4);
+      v = _mm256_add_epi8(v, v);
+    }
+  }
+#endif
 
-      pos++;
+#if defined(FRAMEUTIL_SSE2)
+  const __m128i sse2Shift = _mm_cvtsi32_si128(8 - planes);
+  for (; pos + 2 <= groups; pos += 2)
+  {
+    __m128i v = _mm_sll_epi16(_mm_loadu_si128((const __m128i*)&pFrame[pos * 8]), sse2Shift);
+    for (int i = planes - 1; i >= 0; i--)
+    {
+      uint16_t mask = (uint16_t)_mm_movemask_epi8(v);
+      memcpy(&pPlanes[i * planeSize + pos], &mask, 2);
+      v = _mm_add_epi8(v, v);
+    }
+  }
+#elif defined(FRAMEUTIL_NEON)
+  static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t neonWeights = vld1q_u8(weights);
+  const int8x16_t neonShift = vdupq_n_s8((int8_t)(8 - planes));
+  for (; pos + 2 <= groups; pos += 2)
+  {
+    uint8x16_t v = vshlq_u8(vld1q_u8(&pFrame[pos * 8]), neonShift);
+    for (int i = planes - 1; i >= 0; i--)
+    {
+      // NEON has no movemask: spread the sign bit, weight it by lane and add the lanes of each half.
+      uint8x16_t bits = vandq_u8(vreinterpretq_u8_s8(vshrq_n_s8(vreinterpretq_s8_u8(v), 7)), neonWeights);
+      uint8x8_t sum = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+      sum = vpadd_u8(sum, sum);
+      sum = vpadd_u8(sum, sum);
+      pPlanes[i * planeSize + pos] = vget_lane_u8(sum, 0);
+      pPlanes[i * planeSize + pos + 1] = vget_lane_u8(sum, 1);
+      v = vaddq_u8(v, v);
     }
   }
+#endif
 
-  free(bd);
+  for (; pos < groups; pos++)
+  {
+    uint64_t pixels = Load64(&pFrame[pos * 8]);
+    for (int i = 0; i < planes; i++)
+    {
+      pPlanes[i * planeSize + pos] = PackPlane64(pixels, i);
+    }
+  }
 }
 
-inline void Helper::ConvertToRgb24(uint8_t* pFrameRgb24, uint8_t* pFrame, int size, uint8_t* pPalette)
+inline void SplitPlanes(uint8_t* pPlanes, const uint8_t* pFrame, int planeSize, int groups, int bitlen)
 {
-  for (int i = 0; i < size; i++)
+  switch (bitlen)
   {
-    memcpy(&pFrameRgb24[i * 3], &pPalette[pFrame[i] * 3], 3);
+    case 2:
+      SplitPlanes<2>(pPlanes, pFrame, planeSize, groups, bitlen);
+      break;
+    case 4:
+      SplitPlanes<4>(pPlanes, pFrame, planeSize, groups, bitlen);
+      break;
+    case 6:
+      SplitPlanes<6>(pPlanes, pFrame, planeSize, groups, bitlen);
+      break;
+    case 8:
+      SplitPlanes<8>(pPlanes, pFrame, planeSize, groups, bitlen);
+      break;
+    default:
+      SplitPlanes<0>(pPlanes, pFrame, planeSize, groups, bitlen);
+      break;
   }
 }
 
-inline void Helper::SplitIntoRgbPlanes(const uint16_t* rgb565, int rgb565Size, int width, int numLogicalRows,
-                                       uint8_t* dest, ColorMatrix colorMatrix)
+inline void Store64(uint8_t* p, uint64_t v)
 {
-  constexpr int pairOffset = 16;
-  int height = rgb565Size / width;
-  int subframeSize = rgb565Size / 2;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  memcpy(p, &v, sizeof(v));
+}
 
-  for (int x = 0; x < width; ++x)
+// Spreads bit n of a plane byte into byte n as 0 or 1, the inverse of PackPlane64().
+inline uint64_t UnpackPlane64(uint8_t bits)
+{
+  uint64_t spread = (bits * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+  // Adding 0x7f sets the top bit of every byte that holds a non-zero value, no byte can overflow.
+  return ((spread + 0x7f7f7f7f7f7f7f7fULL) >> 7) & 0x0101010101010101ULL;
+}
+
+// Inverse of SplitPlanes(): rebuilds 8 indexed pixels from one byte of each plane, for `groups` consecutive bytes of
+// planes that are planeSize bytes apart.
+template <int Bits>
+inline void JoinPlanes(uint8_t* pFrame, const uint8_t* pPlanes, int planeSize, int groups, int bitlen)
+{
+  const int planes = Bits > 0 ? Bits : bitlen;
+  int pos = 0;
+
+#if defined(FRAMEUTIL_AVX2)
+  // Within each 128-bit lane, bytes 0-7 pick up the first and bytes 8-15 the second plane byte of that lane.
+  const __m256i avx2Spread =
+      _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+  const __m256i avx2Bits = _mm256_set1_epi64x(0x8040201008040201LL);
+  for (; pos + 4 <= groups; pos += 4)
   {
-    for (int y = 0; y < height; ++y)
+    __m256i pixels = _mm256_setzero_si256();
+    for (int i = 0; i < planes; i++)
     {
-      if (y % (pairOffset * 2) >= pairOffset) continue;
-
-      int inputIndex0 = y * width + x;
-      int inputIndex1 = inputIndex0 + pairOffset * width;
+      uint32_t bytes;
+      memcpy(&bytes, &pPlanes[i * planeSize + pos], 4);
+      __m256i v = _mm256_and_si256(_mm256_shuffle_epi8(_mm256_set1_epi32((int)bytes), avx2Spread), avx2Bits);
+      v = _mm256_and_si256(_mm256_cmpeq_epi8(v, avx2Bits), _mm256_set1_epi8((char)(1 << i)));
+      pixels = _mm256_or_si256(pixels, v);
+    }
+    _mm256_storeu_si256((__m256i*)&pFrame[pos * 8], pixels);
+  }
+#endif
 
-      uint16_t color0 = rgb565[inputIndex0];
-      uint16_t color1 = rgb565[inputIndex1];
+#if defined(FRAMEUTIL_SSE2)
+  const __m128i sse2Bits = _mm_set1_epi64x(0x8040201008040201LL);
+  for (; pos + 2 <= groups; pos += 2)
+  {
+    __m128i pixels = _mm_setzero_si128();
+    for (int i = 0; i < planes; i++)
+    {
+      const uint8_t* pPlane = &pPlanes[i * planeSize + pos];
+      __m128i v = _mm_set_epi64x((long long)(pPlane[1] * 0x0101010101010101ULL),
+                                 (long long)(pPlane[0] * 0x0101010101010101ULL));
+      v = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(v, sse2Bits), sse2Bits), _mm_set1_epi8((char)(1 << i)));
+      pixels = _mm_or_si128(pixels, v);
+    }
+    _mm_storeu_si128((__m128i*)&pFrame[pos * 8], pixels);
+  }
+#elif defined(FRAMEUTIL_NEON)
+  static const uint8_t bitMasks[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+  const uint8x16_t neonBits = vld1q_u8(bitMasks);
+  for (; pos + 2 <= groups; pos += 2)
+  {
+    uint8x16_t pixels = vdupq_n_u8(0);
+    for (int i = 0; i < planes; i++)
+    {
+      const uint8_t* pPlane = &pPlanes[i * planeSize + pos];
+      uint8x16_t v = vcombine_u8(vdup_n_u8(pPlane[0]), vdup_n_u8(pPlane[1]));
+      pixels = vorrq_u8(pixels, vandq_u8(vtstq_u8(v, neonBits), vdupq_n_u8((uint8_t)(1 << i))));
+    }
+    vst1q_u8(&pFrame[pos * 8], pixels);
+  }
+#endif
 
-      int r0 = 0, r1 = 0, g0 = 0, g1 = 0, b0 = 0, b1 = 0;
-      switch (colorMatrix)
-      {
-        case ColorMatrix::Rgb:
-          r0 = (color0 >> 13) /*& 0x7*/;
-          g0 = (color0 >> 8) /*& 0x7*/;
-          b0 = (color0 >> 2) /*& 0x7*/;
-          r1 = (color1 >> 13) /*& 0x7*/;
-          g1 = (color1 >> 8) /*& 0x7*/;
-          b1 = (color1 >> 2) /*& 0x7*/;
-          break;
+  for (; pos < groups; pos++)
+  {
+    uint64_t pixels = 0;
+    for (int i = 0; i < planes; i++)
+    {
+      pixels |= UnpackPlane64(pPlanes[i * planeSize + pos]) << i;
+    }
+    Store64(&pFrame[pos * 8], pixels);
+  }
+}
 
-        case ColorMatrix::Rbg:
-          r0 = (color0 >> 13) /*& 0x7*/;
-          b0 = (color0 >> 8) /*& 0x7*/;
-          g0 = (color0 >> 2) /*& 0x7*/;
-          r1 = (color1 >> 13) /*& 0x7*/;
-          b1 = (color1 >> 8) /*& 0x7*/;
-          g1 = (color1 >> 2) /*& 0x7*/;
-          break;
-      }
+inline void JoinPlanes(uint8_t* pFrame, const uint8_t* pPlanes, int planeSize, int groups, int bitlen)
+{
+  switch (bitlen)
+  {
+    case 2:
+      JoinPlanes<2>(pFrame, pPlanes, planeSize, groups, bitlen);
+      break;
+    case 4:
+      JoinPlanes<4>(pFrame, pPlanes, planeSize, groups, bitlen);
+      break;
+    case 6:
+      JoinPlanes<6>(pFrame, pPlanes, planeSize, groups, bitlen);
+      break;
+    case 8:
+      JoinPlanes<8>(pFrame, pPlanes, planeSize, groups, bitlen);
+      break;
+    default:
+      JoinPlanes<0>(pFrame, pPlanes, planeSize, groups, bitlen);
+      break;
+  }
+}
 
-      for (int subframe = 0; subframe < 3; ++subframe)
-      {
-        uint8_t dotPair = (r0 & 1) << 5 | (g0 & 1) << 4 | (b0 & 1) << 3 | (r1 & 1) << 2 | (g1 & 1) << 1 | (b1 & 1);
-        int indexWithinSubframe = MapAdafruitIndex(x, y, width, height, numLogicalRows);
-        int indexWithinOutput = subframe * subframeSize + indexWithinSubframe;
-        dest[indexWithinOutput] = dotPair;
-        r0 >>= 1;
-        g0 >>= 1;
-        b0 >>= 1;
-        r1 >>= 1;
-        g1 >>= 1;
-        b1 >>= 1;
-      }
-    }
+// Builds the dot pair of the upper pixel color0 and the lower pixel color1 for the subframe whose bits have already
+// been shifted down to the bottom of each color channel.
+template <ColorMatrix M>
+inline uint8_t DotPair(uint32_t color0, uint32_t color1)
+{
+  if (M == ColorMatrix::Rgb)
+  {
+    return (uint8_t)(((color0 >> 8) & 0x20) | ((color0 >> 4) & 0x10) | ((color0 << 1) & 0x08) |
+                     ((color1 >> 11) & 0x04) | ((color1 >> 7) & 0x02) | ((color1 >> 2) & 0x01));
   }
+  return (uint8_t)(((color0 >> 8) & 0x20) | ((color0 << 2) & 0x10) | ((color0 >> 5) & 0x08) |
+                   ((color1 >> 11) & 0x04) | ((color1 >> 1) & 0x02) | ((color1 >> 8) & 0x01));
 }
 
-inline float Helper::CalcBrightness(float x)
+#if defined(FRAMEUTIL_SSE2)
+template <ColorMatrix M>
+inline __m128i DotPairs(__m128i color0, __m128i color1)
 {
-  // function to improve the brightness with fx=ax²+bc+c, f(0)=0, f(1)=1, f'(1.1)=0
-  return (-x * x + 2.1f * x) / 1.1f;
+  const __m128i r0 = _mm_and_si128(_mm_srli_epi16(color0, 8), _mm_set1_epi16(0x20));
+  const __m128i r1 = _mm_and_si128(_mm_srli_epi16(color1, 11), _mm_set1_epi16(0x04));
+  __m128i gb;
+  if (M == ColorMatrix::Rgb)
+  {
+    gb = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi16(color0, 4), _mm_set1_epi16(0x10)),
+                                   _mm_and_si128(_mm_slli_epi16(color0, 1), _mm_set1_epi16(0x08))),
+                      _mm_or_si128(_mm_and_si128(_mm_srli_epi16(color1, 7), _mm_set1_epi16(0x02)),
+                                   _mm_and_si128(_mm_srli_epi16(color1, 2), _mm_set1_epi16(0x01))));
+  }
+  else
+  {
+    gb = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_slli_epi16(color0, 2), _mm_set1_epi16(0x10)),
+                                   _mm_and_si128(_mm_srli_epi16(color0, 5), _mm_set1_epi16(0x08))),
+                      _mm_or_si128(_mm_and_si128(_mm_srli_epi16(color1, 1), _mm_set1_epi16(0x02)),
+                                   _mm_and_si128(_mm_srli_epi16(color1, 8), _mm_set1_epi16(0x01))));
+  }
+  return _mm_or_si128(_mm_or_si128(r0, r1), gb);
+}
+#elif defined(FRAMEUTIL_NEON)
+template <ColorMatrix M>
+inline uint16x8_t DotPairs(uint16x8_t color0, uint16x8_t color1)
+{
+  const uint16x8_t r0 = vandq_u16(vshrq_n_u16(color0, 8), vdupq_n_u16(0x20));
+  const uint16x8_t r1 = vandq_u16(vshrq_n_u16(color1, 11), vdupq_n_u16(0x04));
+  uint16x8_t gb;
+  if (M == ColorMatrix::Rgb)
+  {
+    gb = vorrq_u16(vorrq_u16(vandq_u16(vshrq_n_u16(color0, 4), vdupq_n_u16(0x10)),
+                             vandq_u16(vshlq_n_u16(color0, 1), vdupq_n_u16(0x08))),
+                   vorrq_u16(vandq_u16(vshrq_n_u16(color1, 7), vdupq_n_u16(0x02)),
+                             vandq_u16(vshrq_n_u16(color1, 2), vdupq_n_u16(0x01))));
+  }
+  else
+  {
+    gb = vorrq_u16(vorrq_u16(vandq_u16(vshlq_n_u16(color0, 2), vdupq_n_u16(0x10)),
+                             vandq_u16(vshrq_n_u16(color0, 5), vdupq_n_u16(0x08))),
+                   vorrq_u16(vandq_u16(vshrq_n_u16(color1, 1), vdupq_n_u16(0x02)),
+                             vandq_u16(vshrq_n_u16(color1, 8), vdupq_n_u16(0x01))));
+  }
+  return vorrq_u16(vorrq_u16(r0, r1), gb);
 }
+#endif
 
-inline void Helper::ScaleDownIndexed(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
-                                     const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight)
+template <ColorMatrix M>
+inline void SplitIntoRgbPlanes(const uint16_t* rgb565, const PanelLayout& layout, uint8_t* dest)
 {
-  memset(pDestFrame, 0, destWidth * destHeight);
-  uint8_t xOffset = (destWidth - (srcWidth / 2)) / 2;
-  uint8_t yOffset = (destHeight - (srcHeight / 2)) / 2;
+  constexpr int pairOffset = 16;
+  const int subframeSize = layout.GetSubframeSize();
+  const int lowerOffset = pairOffset * layout.GetWidth();
 
-  // for half scaling we take the 4 points and look if there is one color repeated
-  for (uint8_t y = 0; y < srcHeight; y += 2)
+  for (const PanelLayout::Run& run : layout.GetRuns())
   {
-    std::vector<uint8_t> row;
-    row.reserve(srcWidth / 2);
+    const uint16_t* pUpper = &rgb565[run.src];
+    const uint16_t* pLower = pUpper + lowerOffset;
+    uint8_t* pDest = &dest[run.dest];
+    int i = 0;
 
-    for (uint16_t x = 0; x < srcWidth; x += 2)
+#if defined(FRAMEUTIL_SSE2)
+    for (; i + 8 <= run.length; i += 8)
     {
-      uint8_t upper_left = pSrcFrame[y * srcWidth + x];
-      uint8_t upper_right = pSrcFrame[y * srcWidth + x + 1];
-      uint8_t lower_left = pSrcFrame[(y + 1) * srcWidth + x];
-      uint8_t lower_right = pSrcFrame[(y + 1) * srcWidth + x + 1];
-
-      if (x < srcWidth / 2)
+      __m128i color0 = _mm_loadu_si128((const __m128i*)&pUpper[i]);
+      __m128i color1 = _mm_loadu_si128((const __m128i*)&pLower[i]);
+      for (int subframe = 0; subframe < 3; ++subframe)
       {
-        if (y < srcHeight / 2)
-        {
-          if (upper_left == upper_right || upper_left == lower_left || upper_left == lower_right)
-            row.push_back(upper_left);
-          else if (upper_right == lower_left || upper_right == lower_right)
-            row.push_back(upper_right);
-          else if (lower_left == lower_right)
-            row.push_back(lower_left);
-          else
-            row.push_back(upper_left);
-        }
-        else
-        {
-          if (lower_left == lower_right || lower_left == upper_left || lower_left == upper_right)
-            row.push_back(lower_right);
-          else if (lower_right == upper_left || lower_right == upper_right)
-            row.push_back(lower_right);
-          else if (upper_left == upper_right)
-            row.push_back(upper_left);
-          else
-            row.push_back(lower_left);
-        }
+        __m128i dotPairs = DotPairs<M>(color0, color1);
+        _mm_storel_epi64((__m128i*)&pDest[subframe * subframeSize + i], _mm_packus_epi16(dotPairs, dotPairs));
+        color0 = _mm_srli_epi16(color0, 1);
+        color1 = _mm_srli_epi16(color1, 1);
       }
-      else
+    }
+#elif defined(FRAMEUTIL_NEON)
+    for (; i + 8 <= run.length; i += 8)
+    {
+      uint16x8_t color0 = vld1q_u16(&pUpper[i]);
+      uint16x8_t color1 = vld1q_u16(&pLower[i]);
+      for (int subframe = 0; subframe < 3; ++subframe)
       {
-        if (y < srcHeight / 2)
-        {
-          if (upper_right == upper_left || upper_right == lower_right || upper_right == lower_left)
-            row.push_back(upper_right);
-          else if (upper_left == lower_right || upper_left == lower_left)
-            row.push_back(upper_left);
-          else if (lower_right == lower_left)
-            row.push_back(lower_right);
-          else
-            row.push_back(upper_right);
-        }
-        else
-        {
-          if (lower_right == lower_left || lower_right == upper_right || lower_right == upper_left)
-            row.push_back(lower_right);
-          else if (lower_left == upper_right || lower_left == upper_left)
-            row.push_back(lower_left);
-          else if (upper_right == upper_left)
-            row.push_back(upper_right);
-          else
-            row.push_back(lower_right);
-        }
+        vst1_u8(&pDest[subframe * subframeSize + i], vmovn_u16(DotPairs<M>(color0, color1)));
+        color0 = vshrq_n_u16(color0, 1);
+        color1 = vshrq_n_u16(color1, 1);
       }
     }
+#endif
 
-    memcpy(&pDestFrame[(yOffset + (y / 2)) * destWidth + xOffset], row.data(), srcWidth / 2);
+    for (; i < run.length; i++)
+    {
+      uint32_t color0 = pUpper[i];
+      uint32_t color1 = pLower[i];
+      for (int subframe = 0; subframe < 3; ++subframe)
+      {
+        pDest[subframe * subframeSize + i] = DotPair<M>(color0, color1);
+        color0 >>= 1;
+        color1 >>= 1;
+      }
+    }
   }
 }
 
-inline void Helper::ScaleDownPUP(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
-                                 const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight)
+// Byte n of the result is the dot pair of plane n.
+template <ColorMatrix M>
+inline uint64_t BcmDotPairs(const BcmLut& lut, uint32_t color0, uint32_t color1)
 {
-  memset(pDestFrame, 0, destWidth * destHeight);
-  uint8_t xOffset = (destWidth - (srcWidth / 2)) / 2;
-  uint8_t yOffset = (destHeight - (srcHeight / 2)) / 2;
-
-  // for half scaling we take the 4 points and look if there is one color repeated
-  for (uint8_t y = 0; y < srcHeight; y += 2)
-  {
-    std::vector<uint8_t> row;
-    row.reserve(srcWidth / 2);
-
-    for (uint16_t x = 0; x < srcWidth; x += 2)
-    {
-      uint8_t pixel1 = pSrcFrame[y * srcWidth + x];
-      uint8_t pixel2 = pSrcFrame[y * srcWidth + x + 1];
-      uint8_t pixel3 = pSrcFrame[(y + 1) * srcWidth + x];
-      uint8_t pixel4 = pSrcFrame[(y + 1) * srcWidth + x + 1];
-
-      if (pixel1 == pixel2 || pixel1 == pixel3 || pixel1 == pixel4)
-        row.push_back(pixel1);
-      else if (pixel2 == pixel3 || pixel2 == pixel4)
-        row.push_back(pixel2);
-      else if (pixel3 == pixel4)
-        row.push_back(pixel3);
-      else
-        row.push_back(pixel1);
-    }
-
-    memcpy(&pDestFrame[(yOffset + (y / 2)) * destWidth + xOffset], row.data(), srcWidth / 2);
-  }
+  uint64_t red = (lut.GetRed(color0 >> 11) << 5) | (lut.GetRed(color1 >> 11) << 2);
+  uint64_t green = lut.GetGreen((color0 >> 5) & 0x3f);
+  uint64_t green1 = lut.GetGreen((color1 >> 5) & 0x3f);
+  uint64_t blue = lut.GetBlue(color0 & 0x1f);
+  uint64_t blue1 = lut.GetBlue(color1 & 0x1f);
+  if (M == ColorMatrix::Rgb) return red | (green << 4) | (blue << 3) | (green1 << 1) | blue1;
+  return red | (blue << 4) | (green << 3) | (blue1 << 1) | green1;
 }
 
-inline void Helper::ScaleDown(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
-                              const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight, uint8_t bits)
+template <ColorMatrix M>
+inline void SplitIntoBcmPlanes(const uint16_t* rgb565, const PanelLayout& layout, const BcmLut& lut, uint8_t* dest)
 {
-  uint8_t xOffset = (destWidth - (srcWidth / 2)) / 2;
-  uint8_t yOffset = (destHeight - (srcHeight / 2)) / 2;
-  uint8_t bytes = bits / 8;  // RGB24 (3 byte) or RGB16 (2 byte) or indexed (1 byte)
-  memset(pDestFrame, 0, destWidth * destHeight * bytes);
+  constexpr int pairOffset = 16;
+  const int subframeSize = layout.GetSubframeSize();
+  const int lowerOffset = pairOffset * layout.GetWidth();
+  const int depth = lut.GetDepth();
 
-  for (uint8_t y = 0; y < srcHeight; y += 2)
+  for (const PanelLayout::Run& run : layout.GetRuns())
   {
-    uint16_t upper_left = (y * srcWidth) * bytes;
-    uint16_t upper_right = upper_left + bytes;
-    uint16_t lower_left = upper_left + (srcWidth * bytes);
-    uint16_t lower_right = lower_left + bytes;
-    uint16_t target = ((((y / 2) + yOffset) * destWidth) + xOffset) * bytes;
+    const uint16_t* pUpper = &rgb565[run.src];
+    const uint16_t* pLower = pUpper + lowerOffset;
+    uint8_t* pDest = &dest[run.dest];
+    int i = 0;
 
-    for (uint16_t x = 0; x < srcWidth; x += 2)
+#if defined(FRAMEUTIL_SSE2) || defined(FRAMEUTIL_NEON)
+    for (; i + 8 <= run.length; i += 8)
     {
-      if (x < srcWidth / 2)
+      uint64_t dotPairs[8];
+      for (int k = 0; k < 8; k++)
       {
-        if (y < srcHeight / 2)
-        {
-          if (memcmp(&pSrcFrame[upper_left], &pSrcFrame[upper_right], bytes) == 0 ||
-              memcmp(&pSrcFrame[upper_left], &pSrcFrame[lower_left], bytes) == 0 ||
-              memcmp(&pSrcFrame[upper_left], &pSrcFrame[lower_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_left], bytes);
-          else if (memcmp(&pSrcFrame[upper_right], &pSrcFrame[lower_left], bytes) == 0 ||
-                   memcmp(&pSrcFrame[upper_right], &pSrcFrame[lower_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_right], bytes);
-          else if (memcmp(&pSrcFrame[lower_left], &pSrcFrame[lower_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_left], bytes);
-          else
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_left], bytes);
-        }
-        else
-        {
-          if (memcmp(&pSrcFrame[lower_left], &pSrcFrame[lower_right], bytes) == 0 ||
-              memcmp(&pSrcFrame[lower_left], &pSrcFrame[upper_left], bytes) == 0 ||
-              memcmp(&pSrcFrame[lower_left], &pSrcFrame[upper_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_left], bytes);
-          else if (memcmp(&pSrcFrame[lower_right], &pSrcFrame[upper_left], bytes) == 0 ||
-                   memcmp(&pSrcFrame[lower_right], &pSrcFrame[upper_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_right], bytes);
-          else if (memcmp(&pSrcFrame[upper_left], &pSrcFrame[upper_right], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_left], bytes);
-          else
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_left], bytes);
-        }
+        dotPairs[k] = BcmDotPairs<M>(lut, pUpper[i + k], pLower[i + k]);
       }
-      else
+
+      // 8x8 byte transpose: row k holds the planes of dot pair k, column n becomes 8 bytes of plane n.
+      uint8_t planes[64];
+#if defined(FRAMEUTIL_SSE2)
+      __m128i rows01 = _mm_loadu_si128((const __m128i*)&dotPairs[0]);
+      __m128i rows23 = _mm_loadu_si128((const __m128i*)&dotPairs[2]);
+      __m128i rows45 = _mm_loadu_si128((const __m128i*)&dotPairs[4]);
+      __m128i rows67 = _mm_loadu_si128((const __m128i*)&dotPairs[6]);
+      __m128i t0 = _mm_unpacklo_epi8(rows01, _mm_srli_si128(rows01, 8));
+      __m128i t1 = _mm_unpacklo_epi8(rows23, _mm_srli_si128(rows23, 8));
+      __m128i t2 = _mm_unpacklo_epi8(rows45, _mm_srli_si128(rows45, 8));
+      __m128i t3 = _mm_unpacklo_epi8(rows67, _mm_srli_si128(rows67, 8));
+      __m128i u0 = _mm_unpacklo_epi16(t0, t1);
+      __m128i u1 = _mm_unpackhi_epi16(t0, t1);
+      __m128i u2 = _mm_unpacklo_epi16(t2, t3);
+      __m128i u3 = _mm_unpackhi_epi16(t2, t3);
+      _mm_storeu_si128((__m128i*)&planes[0], _mm_unpacklo_epi32(u0, u2));
+      _mm_storeu_si128((__m128i*)&planes[16], _mm_unpackhi_epi32(u0, u2));
+      _mm_storeu_si128((__m128i*)&planes[32], _mm_unpacklo_epi32(u1, u3));
+      _mm_storeu_si128((__m128i*)&planes[48], _mm_unpackhi_epi32(u1, u3));
+#else
+      uint8x8x2_t b0 = vtrn_u8(vcreate_u8(dotPairs[0]), vcreate_u8(dotPairs[1]));
+      uint8x8x2_t b1 = vtrn_u8(vcreate_u8(dotPairs[2]), vcreate_u8(dotPairs[3]));
+      uint8x8x2_t b2 = vtrn_u8(vcreate_u8(dotPairs[4]), vcreate_u8(dotPairs[5]));
+      uint8x8x2_t b3 = vtrn_u8(vcreate_u8(dotPairs[6]), vcreate_u8(dotPairs[7]));
+      uint16x4x2_t c0 = vtrn_u16(vreinterpret_u16_u8(b0.val[0]), vreinterpret_u16_u8(b1.val[0]));
+      uint16x4x2_t c1 = vtrn_u16(vreinterpret_u16_u8(b0.val[1]), vreinterpret_u16_u8(b1.val[1]));
+      uint16x4x2_t c2 = vtrn_u16(vreinterpret_u16_u8(b2.val[0]), vreinterpret_u16_u8(b3.val[0]));
+      uint16x4x2_t c3 = vtrn_u16(vreinterpret_u16_u8(b2.val[1]), vreinterpret_u16_u8(b3.val[1]));
+      uint32x2x2_t d0 = vtrn_u32(vreinterpret_u32_u16(c0.val[0]), vreinterpret_u32_u16(c2.val[0]));
+      uint32x2x2_t d1 = vtrn_u32(vreinterpret_u32_u16(c1.val[0]), vreinterpret_u32_u16(c3.val[0]));
+      uint32x2x2_t d2 = vtrn_u32(vreinterpret_u32_u16(c0.val[1]), vreinterpret_u32_u16(c2.val[1]));
+      uint32x2x2_t d3 = vtrn_u32(vreinterpret_u32_u16(c1.val[1]), vreinterpret_u32_u16(c3.val[1]));
+      vst1_u8(&planes[0], vreinterpret_u8_u32(d0.val[0]));
+      vst1_u8(&planes[8], vreinterpret_u8_u32(d1.val[0]));
+      vst1_u8(&planes[16], vreinterpret_u8_u32(d2.val[0]));
+      vst1_u8(&planes[24], vreinterpret_u8_u32(d3.val[0]));
+      vst1_u8(&planes[32], vreinterpret_u8_u32(d0.val[1]));
+      vst1_u8(&planes[40], vreinterpret_u8_u32(d1.val[1]));
+      vst1_u8(&planes[48], vreinterpret_u8_u32(d2.val[1]));
+      vst1_u8(&planes[56], vreinterpret_u8_u32(d3.val[1]));
+#endif
+
+      for (int plane = 0; plane < depth; plane++)
       {
-        if (y < srcHeight / 2)
-        {
-          if (memcmp(&pSrcFrame[upper_right], &pSrcFrame[upper_left], bytes) == 0 ||
-              memcmp(&pSrcFrame[upper_right], &pSrcFrame[lower_right], bytes) == 0 ||
-              memcmp(&pSrcFrame[upper_right], &pSrcFrame[lower_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_right], bytes);
-          else if (memcmp(&pSrcFrame[upper_left], &pSrcFrame[lower_right], bytes) == 0 ||
-                   memcmp(&pSrcFrame[upper_left], &pSrcFrame[lower_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_left], bytes);
-          else if (memcmp(&pSrcFrame[lower_right], &pSrcFrame[lower_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_right], bytes);
-          else
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_right], bytes);
-        }
-        else
-        {
-          if (memcmp(&pSrcFrame[lower_right], &pSrcFrame[lower_left], bytes) == 0 ||
-              memcmp(&pSrcFrame[lower_right], &pSrcFrame[upper_right], bytes) == 0 ||
-              memcmp(&pSrcFrame[lower_right], &pSrcFrame[upper_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_right], bytes);
-          else if (memcmp(&pSrcFrame[lower_left], &pSrcFrame[upper_right], bytes) == 0 ||
-                   memcmp(&pSrcFrame[lower_left], &pSrcFrame[upper_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_left], bytes);
-          else if (memcmp(&pSrcFrame[upper_right], &pSrcFrame[upper_left], bytes) == 0)
-            memcpy(&pDestFrame[target], &pSrcFrame[upper_right], bytes);
-          else
-            memcpy(&pDestFrame[target], &pSrcFrame[lower_right], bytes);
-        }
+        memcpy(&pDest[plane * subframeSize + i], &planes[plane * 8], 8);
       }
+    }
+#endif
 
-      upper_left += 2 * bytes;
-      upper_right += 2 * bytes;
-      lower_left += 2 * bytes;
-      lower_right += 2 * bytes;
-      target += bytes;
+    for (; i < run.length; i++)
+    {
+      uint64_t dotPairs = BcmDotPairs<M>(lut, pUpper[i], pLower[i]);
+      for (int plane = 0; plane < depth; plane++)
+      {
+        pDest[plane * subframeSize + i] = (uint8_t)(dotPairs >> (plane * 8));
+      }
     }
   }
 }
 
-inline void Helper::ScaleUp(uint8_t* pDestFrame, const uint8_t* pSrcFrame, const uint16_t srcWidth,
-                            const uint8_t srcHeight, uint8_t bits)
+// scale2x rule for one source pixel e with its neighbours b (above), d (left), f (right) and h (below).
+template <typename T>
+inline void ScaleUpPixel(T* pDest0, T* pDest1, const T& b, const T& d, const T& e, const T& f, const T& h)
 {
-  uint8_t bytes = bits / 8;  // RGB24 (3 byte) or RGB16 (2 byte) or indexed (1 byte)
-  uint16_t destWidth = srcWidth * 2;
-  memset(pDestFrame, 0, srcWidth * srcHeight * 4 * bytes);
+  if (!(b == h) && !(d == f))
+  {
+    pDest0[0] = d == b ? d : e;
+    pDest0[1] = b == f ? f : e;
+    pDest1[0] = d == h ? d : e;
+    pDest1[1] = h == f ? f : e;
+  }
+  else
+  {
+    pDest0[0] = pDest0[1] = pDest1[0] = pDest1[1] = e;
+  }
+}
 
-  // we implement scale2x http://www.scale2x.it/algorithm
-  uint16_t row = srcWidth * bytes;
-  uint8_t* a = (uint8_t*)malloc(bytes);
-  uint8_t* b = (uint8_t*)malloc(bytes);
-  uint8_t* c = (uint8_t*)malloc(bytes);
-  uint8_t* d = (uint8_t*)malloc(bytes);
-  uint8_t* e = (uint8_t*)malloc(bytes);
-  uint8_t* f = (uint8_t*)malloc(bytes);
-  uint8_t* g = (uint8_t*)malloc(bytes);
-  uint8_t* h = (uint8_t*)malloc(bytes);
-  uint8_t* i = (uint8_t*)malloc(bytes);
-
-  for (uint16_t y = 0; y < srcHeight; y++)
-  {
-    for (uint16_t x = 0; x < srcWidth; x++)
-    {
-      for (uint8_t tc = 0; tc < bytes; tc++)
-      {
-        if (x == 0 && y == 0)
-        {
-          a[tc] = b[tc] = d[tc] = e[tc] = pSrcFrame[tc];
-          c[tc] = f[tc] = pSrcFrame[bytes + tc];
-          g[tc] = h[tc] = pSrcFrame[row + tc];
-          i[tc] = pSrcFrame[row + bytes + tc];
-        }
-        else if ((x == 0) && (y == srcHeight - 1))
-        {
-          a[tc] = b[tc] = pSrcFrame[(y - 1) * row + tc];
-          c[tc] = pSrcFrame[(y - 1) * row + bytes + tc];
-          d[tc] = g[tc] = h[tc] = e[tc] = pSrcFrame[y * row + tc];
-          f[tc] = i[tc] = pSrcFrame[y * row + bytes + tc];
-        }
-        else if ((x == srcWidth - 1) && (y == 0))
-        {
-          a[tc] = d[tc] = pSrcFrame[x * bytes - bytes + tc];
-          b[tc] = c[tc] = f[tc] = e[tc] = pSrcFrame[x * bytes + tc];
-          g[tc] = pSrcFrame[row + x * bytes - bytes + tc];
-          h[tc] = i[tc] = pSrcFrame[row + x * bytes + tc];
-        }
-        else if ((x == srcWidth - 1) && (y == srcHeight - 1))
-        {
-          a[tc] = pSrcFrame[y * row - 2 * bytes + tc];
-          b[tc] = c[tc] = pSrcFrame[y * row - bytes + tc];
-          d[tc] = g[tc] = pSrcFrame[srcHeight * row - 2 * bytes + tc];
-          e[tc] = f[tc] = h[tc] = i[tc] = pSrcFrame[srcHeight * row - bytes + tc];
-        }
-        else if (x == 0)
-        {
-          a[tc] = b[tc] = pSrcFrame[(y - 1) * row + tc];
-          c[tc] = pSrcFrame[(y - 1) * row + bytes + tc];
-          d[tc] = e[tc] = pSrcFrame[y * row + tc];
-          f[tc] = pSrcFrame[y * row + bytes + tc];
-          g[tc] = h[tc] = pSrcFrame[(y + 1) * row + tc];
-          i[tc] = pSrcFrame[(y + 1) * row + bytes + tc];
-        }
-        else if (x == srcWidth - 1)
-        {
-          a[tc] = pSrcFrame[y * row - 2 * bytes + tc];
-          b[tc] = c[tc] = pSrcFrame[y * row - bytes + tc];
-          d[tc] = pSrcFrame[(y + 1) * row - 2 * bytes + tc];
-          e[tc] = f[tc] = pSrcFrame[(y + 1) * row - bytes + tc];
-          g[tc] = pSrcFrame[(y + 2) * row - 2 * bytes + tc];
-          h[tc] = i[tc] = pSrcFrame[(y + 2) * row - bytes + tc];
-        }
-        else if (y == 0)
+// Scales the interior pixels [x, end) of a row, returns where the vector loop stopped. Pixel types without a vector
+// kernel leave everything to the scalar loop.
+template <typename T>
+inline int ScaleUpInterior(T*, T*, const T*, const T*, const T*, int x, int)
+{
+  return x;
+}
+
+#if defined(FRAMEUTIL_SSE2) || defined(FRAMEUTIL_NEON)
+// Vector operations for one pixel size, used by ScaleUpVector() and ScaleDownVector().
+#if defined(FRAMEUTIL_AVX2)
+struct VectorU8
+{
+  using Vec = __m256i;
+  static constexpr int count = 32;
+  static Vec Load(const uint8_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static Vec Eq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+  static Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_epi8(b, a, mask); }
+  static void StoreInterleaved(uint8_t* p, Vec a, Vec b)
+  {
+    Vec lo = _mm256_unpacklo_epi8(a, b);
+    Vec hi = _mm256_unpackhi_epi8(a, b);
+    _mm256_storeu_si256((__m256i*)p, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(p + count), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  static void Store(uint8_t* p, Vec a) { _mm256_storeu_si256((__m256i*)p, a); }
+  static void Deinterleave(const uint8_t* p, Vec& even, Vec& odd)
+  {
+    // The packs work per 128-bit lane, the permute puts the quarters back in order.
+    Vec a = Load(p);
+    Vec b = Load(p + count);
+    Vec low = _mm256_set1_epi16(0xff);
+    even = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(a, low), _mm256_and_si256(b, low)), 0xd8);
+    odd = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 0xd8);
+  }
+};
+
+struct VectorU16
+{
+  using Vec = __m256i;
+  static constexpr int count = 16;
+  static Vec Load(const uint16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+  static Vec Eq(Vec a, Vec b) { return _mm256_cmpeq_epi16(a, b); }
+  static Vec Or(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return _mm256_blendv_epi8(b, a, mask); }
+  static void StoreInterleaved(uint16_t* p, Vec a, Vec b)
+  {
+    Vec lo = _mm256_unpacklo_epi16(a, b);
+    Vec hi = _mm256_unpackhi_epi16(a, b);
+    _mm256_storeu_si256((__m256i*)p, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(p + count), _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  static void Store(uint16_t* p, Vec a) { _mm256_storeu_si256((__m256i*)p, a); }
+  static void Deinterleave(const uint16_t* p, Vec& even, Vec& odd)
+  {
+    // Sign extending both halves lets the saturating pack return them unchanged.
+    Vec a = Load(p);
+    Vec b = Load(p + count);
+    even = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16),
+                              _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16));
+    odd = _mm256_packs_epi32(_mm256_srai_epi32(a, 16), _mm256_srai_epi32(b, 16));
+    even = _mm256_permute4x64_epi64(even, 0xd8);
+    odd = _mm256_permute4x64_epi64(odd, 0xd8);
+  }
+};
+#elif defined(FRAMEUTIL_SSE2)
+struct VectorU8
+{
+  using Vec = __m128i;
+  static constexpr int count = 16;
+  static Vec Load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static Vec Eq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+  static Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+  static void StoreInterleaved(uint8_t* p, Vec a, Vec b)
+  {
+    _mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi8(a, b));
+    _mm_storeu_si128((__m128i*)(p + count), _mm_unpackhi_epi8(a, b));
+  }
+  static void Store(uint8_t* p, Vec a) { _mm_storeu_si128((__m128i*)p, a); }
+  static void Deinterleave(const uint8_t* p, Vec& even, Vec& odd)
+  {
+    Vec a = Load(p);
+    Vec b = Load(p + count);
+    Vec low = _mm_set1_epi16(0xff);
+    even = _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+    odd = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+  }
+};
+
+struct VectorU16
+{
+  using Vec = __m128i;
+  static constexpr int count = 8;
+  static Vec Load(const uint16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+  static Vec Eq(Vec a, Vec b) { return _mm_cmpeq_epi16(a, b); }
+  static Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+  static void StoreInterleaved(uint16_t* p, Vec a, Vec b)
+  {
+    _mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(a, b));
+    _mm_storeu_si128((__m128i*)(p + count), _mm_unpackhi_epi16(a, b));
+  }
+  static void Store(uint16_t* p, Vec a) { _mm_storeu_si128((__m128i*)p, a); }
+  static void Deinterleave(const uint16_t* p, Vec& even, Vec& odd)
+  {
+    // Sign extending both halves lets the saturating pack return them unchanged.
+    Vec a = Load(p);
+    Vec b = Load(p + count);
+    even = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16), _mm_srai_epi32(_mm_slli_epi32(b, 16), 16));
+    odd = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+  }
+};
+#else
+struct VectorU8
+{
+  using Vec = uint8x16_t;
+  static constexpr int count = 16;
+  static Vec Load(const uint8_t* p) { return vld1q_u8(p); }
+  static Vec Eq(Vec a, Vec b) { return vceqq_u8(a, b); }
+  static Vec Or(Vec a, Vec b) { return vorrq_u8(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return vbicq_u8(b, a); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return vbslq_u8(mask, a, b); }
+  static void StoreInterleaved(uint8_t* p, Vec a, Vec b) { vst2q_u8(p, uint8x16x2_t{{a, b}}); }
+  static void Store(uint8_t* p, Vec a) { vst1q_u8(p, a); }
+  static void Deinterleave(const uint8_t* p, Vec& even, Vec& odd)
+  {
+    uint8x16x2_t v = vld2q_u8(p);
+    even = v.val[0];
+    odd = v.val[1];
+  }
+};
+
+struct VectorU16
+{
+  using Vec = uint16x8_t;
+  static constexpr int count = 8;
+  static Vec Load(const uint16_t* p) { return vld1q_u16(p); }
+  static Vec Eq(Vec a, Vec b) { return vceqq_u16(a, b); }
+  static Vec Or(Vec a, Vec b) { return vorrq_u16(a, b); }
+  static Vec AndNot(Vec a, Vec b) { return vbicq_u16(b, a); }
+  static Vec Select(Vec mask, Vec a, Vec b) { return vbslq_u16(mask, a, b); }
+  static void StoreInterleaved(uint16_t* p, Vec a, Vec b) { vst2q_u16(p, uint16x8x2_t{{a, b}}); }
+  static void Store(uint16_t* p, Vec a) { vst1q_u16(p, a); }
+  static void Deinterleave(const uint16_t* p, Vec& even, Vec& odd)
+  {
+    uint16x8x2_t v = vld2q_u16(p);
+    even = v.val[0];
+    odd = v.val[1];
+  }
+};
+#endif
+
+// scale2x on V::count pixels at once, AndNot(a, b) being ~a & b.
+template <typename V, typename T>
+inline int ScaleUpVector(T* pDest0, T* pDest1, const T* pAbove, const T* pRow, const T* pBelow, int x, int end)
+{
+  for (; x + V::count <= end; x += V::count)
+  {
+    typename V::Vec b = V::Load(&pAbove[x]);
+    typename V::Vec d = V::Load(&pRow[x - 1]);
+    typename V::Vec e = V::Load(&pRow[x]);
+    typename V::Vec f = V::Load(&pRow[x + 1]);
+    typename V::Vec h = V::Load(&pBelow[x]);
+    typename V::Vec flat = V::Or(V::Eq(b, h), V::Eq(d, f));
+
+    V::StoreInterleaved(&pDest0[x * 2], V::Select(V::AndNot(flat, V::Eq(d, b)), d, e),
+                        V::Select(V::AndNot(flat, V::Eq(b, f)), f, e));
+    V::StoreInterleaved(&pDest1[x * 2], V::Select(V::AndNot(flat, V::Eq(d, h)), d, e),
+                        V::Select(V::AndNot(flat, V::Eq(h, f)), f, e));
+  }
+  return x;
+}
+
+inline int ScaleUpInterior(uint8_t* pDest0, uint8_t* pDest1, const uint8_t* pAbove, const uint8_t* pRow,
+                           const uint8_t* pBelow, int x, int end)
+{
+  return ScaleUpVector<VectorU8>(pDest0, pDest1, pAbove, pRow, pBelow, x, end);
+}
+
+inline int ScaleUpInterior(uint16_t* pDest0, uint16_t* pDest1, const uint16_t* pAbove, const uint16_t* pRow,
+                           const uint16_t* pBelow, int x, int end)
+{
+  return ScaleUpVector<VectorU16>(pDest0, pDest1, pAbove, pRow, pBelow, x, end);
+}
+#endif
+
+// Scales one source row into two destination rows. The first and last column clamp their missing neighbour to
+// themselves, the interior runs without any border checks.
+template <typename T>
+inline void ScaleUpRow(T* pDest0, T* pDest1, const T* pAbove, const T* pRow, const T* pBelow, int width)
+{
+  if (width == 1)
+  {
+    ScaleUpPixel(pDest0, pDest1, pAbove[0], pRow[0], pRow[0], pRow[0], pBelow[0]);
+    return;
+  }
+
+  ScaleUpPixel(pDest0, pDest1, pAbove[0], pRow[0], pRow[0], pRow[1], pBelow[0]);
+
+  int x = ScaleUpInterior(pDest0, pDest1, pAbove, pRow, pBelow, 1, width - 1);
+  for (; x < width - 1; x++)
+  {
+    ScaleUpPixel(&pDest0[x * 2], &pDest1[x * 2], pAbove[x], pRow[x - 1], pRow[x], pRow[x + 1], pBelow[x]);
+  }
+
+  int last = width - 1;
+  ScaleUpPixel(&pDest0[last * 2], &pDest1[last * 2], pAbove[last], pRow[last - 1], pRow[last], pRow[last],
+               pBelow[last]);
+}
+
+// Tie-break rules of the 2:1 downscalers. Quadrant prefers the source pixel pointing towards the nearest frame corner,
+// QuadrantIndexed is the same except that ScaleDownIndexed() has always returned the lower right pixel when the lower
+// left one wins in the lower left quadrant. Pup always prefers the upper left pixel.
+enum class ScaleDownPolicy
+{
+  Quadrant,
+  QuadrantIndexed,
+  Pup
+};
+
+enum class Corner
+{
+  UpperLeft,
+  UpperRight,
+  LowerLeft,
+  LowerRight
+};
+
+// Orders a 2x2 block as preferred pixel, its horizontal, vertical and diagonal neighbour.
+template <Corner C, typename V>
+inline void OrderBlock(const V& ul, const V& ur, const V& ll, const V& lr, V& p1, V& p2, V& p3, V& p4)
+{
+  switch (C)
+  {
+    case Corner::UpperLeft:
+      p1 = ul, p2 = ur, p3 = ll, p4 = lr;
+      break;
+    case Corner::UpperRight:
+      p1 = ur, p2 = ul, p3 = lr, p4 = ll;
+      break;
+    case Corner::LowerLeft:
+      p1 = ll, p2 = lr, p3 = ul, p4 = ur;
+      break;
+    case Corner::LowerRight:
+      p1 = lr, p2 = ll, p3 = ur, p4 = ul;
+      break;
+  }
+}
+
+// Majority vote over a 2x2 block, a pixel that repeats wins and p1 is taken if none does. Quirk returns p2 instead of
+// p1 when p1 repeats, see ScaleDownPolicy::QuadrantIndexed.
+template <bool Quirk, typename T>
+inline T Vote(const T& p1, const T& p2, const T& p3, const T& p4)
+{
+  if (p1 == p2 || p1 == p3 || p1 == p4) return Quirk ? p2 : p1;
+  if (p2 == p3 || p2 == p4) return p2;
+  if (p3 == p4) return p3;
+  return p1;
+}
+
+// Votes on the packed value, comparing three separate bytes per pair would cost far more.
+template <bool Quirk>
+inline Pixel24 Vote(const Pixel24& p1, const Pixel24& p2, const Pixel24& p3, const Pixel24& p4)
+{
+  auto pack = [](const Pixel24& p) { return (uint32_t)p.c[0] | (uint32_t)p.c[1] << 8 | (uint32_t)p.c[2] << 16; };
+  uint32_t vote = Vote<Quirk>(pack(p1), pack(p2), pack(p3), pack(p4));
+  return Pixel24{{(uint8_t)vote, (uint8_t)(vote >> 8), (uint8_t)(vote >> 16)}};
+}
+
+template <Corner C, bool Quirk, typename T>
+inline int ScaleDownVector(T*, const T*, const T*, int x, int)
+{
+  return x;
+}
+
+#if defined(FRAMEUTIL_SSE2) || defined(FRAMEUTIL_NEON)
+template <Corner C, bool Quirk, typename V, typename T>
+inline int ScaleDownVectorSpan(T* pDest, const T* pUpper, const T* pLower, int x, int end)
+{
+  for (; x + V::count <= end; x += V::count)
+  {
+    typename V::Vec ul, ur, ll, lr, p1, p2, p3, p4;
+    V::Deinterleave(&pUpper[x * 2], ul, ur);
+    V::Deinterleave(&pLower[x * 2], ll, lr);
+    OrderBlock<C>(ul, ur, ll, lr, p1, p2, p3, p4);
+
+    typename V::Vec first = V::Or(V::Or(V::Eq(p1, p2), V::Eq(p1, p3)), V::Eq(p1, p4));
+    typename V::Vec second = V::Or(V::Eq(p2, p3), V::Eq(p2, p4));
+    typename V::Vec third = V::Eq(p3, p4);
+    V::Store(&pDest[x], V::Select(first, Quirk ? p2 : p1, V::Select(second, p2, V::Select(third, p3, p1))));
+  }
+  return x;
+}
+
+template <Corner C, bool Quirk>
+inline int ScaleDownVector(uint8_t* pDest, const uint8_t* pUpper, const uint8_t* pLower, int x, int end)
+{
+  return ScaleDownVectorSpan<C, Quirk, VectorU8>(pDest, pUpper, pLower, x, end);
+}
+
+template <Corner C, bool Quirk>
+inline int ScaleDownVector(uint16_t* pDest, const uint16_t* pUpper, const uint16_t* pLower, int x, int end)
+{
+  return ScaleDownVectorSpan<C, Quirk, VectorU16>(pDest, pUpper, pLower, x, end);
+}
+#endif
+
+// Downscales the destination pixels [x, end) of one row from the two source rows above them.
+template <Corner C, bool Quirk, typename T>
+inline void ScaleDownSpan(T* pDest, const T* pUpper, const T* pLower, int x, int end)
+{
+  x = ScaleDownVector<C, Quirk>(pDest, pUpper, pLower, x, end);
+  for (int i = 0; i < end - x; i++)
+  {
+    const T* pUpperPair = &pUpper[(x + i) * 2];
+    const T* pLowerPair = &pLower[(x + i) * 2];
+    T p1, p2, p3, p4;
+    OrderBlock<C>(pUpperPair[0], pUpperPair[1], pLowerPair[0], pLowerPair[1], p1, p2, p3, p4);
+    pDest[x + i] = Vote<Quirk>(p1, p2, p3, p4);
+  }
+}
+
+// Downscales one row of `width` destination pixels from two source rows. The quadrant is picked by the source
+// position, so for odd sizes the left and upper halves are one pixel larger.
+template <ScaleDownPolicy P, typename T>
+inline void ScaleDownRow(T* pDest, const T* pUpper, const T* pLower, int width, bool upperHalf)
+{
+  int leftWidth = (width + 1) / 2;
+
+  if (P == ScaleDownPolicy::Pup)
+  {
+    ScaleDownSpan<Corner::UpperLeft, false>(pDest, pUpper, pLower, 0, width);
+  }
+  else if (upperHalf)
+  {
+    ScaleDownSpan<Corner::UpperLeft, false>(pDest, pUpper, pLower, 0, leftWidth);
+    ScaleDownSpan<Corner::UpperRight, false>(pDest, pUpper, pLower, leftWidth, width);
+  }
+  else
+  {
+    ScaleDownSpan<Corner::LowerLeft, P == ScaleDownPolicy::QuadrantIndexed>(pDest, pUpper, pLower, 0, leftWidth);
+    ScaleDownSpan<Corner::LowerRight, false>(pDest, pUpper, pLower, leftWidth, width);
+  }
+}
+
+// 2:1 majority-vote downscale, centered in the destination frame. Only the border around the scaled image is
+// cleared. Source dimensions are expected to be even.
+template <ScaleDownPolicy P, typename T>
+inline void ScaleDown(T* pDestFrame, int destWidth, int destHeight, const T* pSrcFrame, int srcWidth, int srcHeight)
+{
+  int width = srcWidth / 2;
+  int height = srcHeight / 2;
+  int xOffset = (destWidth - width) / 2;
+  int yOffset = (destHeight - height) / 2;
+  int upperHeight = (height + 1) / 2;
+
+  memset(pDestFrame, 0, (size_t)yOffset * destWidth * sizeof(T));
+  memset(&pDestFrame[(size_t)(yOffset + height) * destWidth], 0,
+         (size_t)(destHeight - yOffset - height) * destWidth * sizeof(T));
+
+  for (int y = 0; y < height; y++)
+  {
+    T* pRow = &pDestFrame[(size_t)(yOffset + y) * destWidth];
+    const T* pUpper = &pSrcFrame[(size_t)y * 2 * srcWidth];
+
+    memset(pRow, 0, xOffset * sizeof(T));
+    memset(&pRow[xOffset + width], 0, (destWidth - xOffset - width) * sizeof(T));
+    ScaleDownRow<P>(&pRow[xOffset], pUpper, pUpper + srcWidth, width, y < upperHeight);
+  }
+}
+
+// scale2x of a strided view into the top left of dest.
+template <typename T>
+inline void ScaleUpView(const FrameView& dest, const FrameView& src)
+{
+  int width = src.GetWidth();
+  int height = src.GetHeight();
+  if (width == 0) return;
+
+  for (int y = 0; y < height; y++)
+  {
+    const T* pAbove = (const T*)src.GetRow(y > 0 ? y - 1 : y);
+    const T* pBelow = (const T*)src.GetRow(y < height - 1 ? y + 1 : y);
+    ScaleUpRow((T*)dest.GetRow(y * 2), (T*)dest.GetRow(y * 2 + 1), pAbove, (const T*)src.GetRow(y), pBelow, width);
+  }
+}
+
+// 2:1 downscale of a strided view into the top left of dest, nothing around it is touched.
+template <ScaleDownPolicy P, typename T>
+inline void ScaleDownView(const FrameView& dest, const FrameView& src)
+{
+  int width = src.GetWidth() / 2;
+  int height = src.GetHeight() / 2;
+  int upperHeight = (height + 1) / 2;
+
+  for (int y = 0; y < height; y++)
+  {
+    ScaleDownRow<P>((T*)dest.GetRow(y), (const T*)src.GetRow(y * 2), (const T*)src.GetRow(y * 2 + 1), width,
+                    y < upperHeight);
+  }
+}
+
+template <ScaleDownPolicy P>
+inline void ScaleDownView(const FrameView& dest, const FrameView& src)
+{
+  if (dest.GetFormat() != src.GetFormat() || dest.GetWidth() < src.GetWidth() / 2 ||
+      dest.GetHeight() < src.GetHeight() / 2)
+    return;
+
+  switch (src.GetFormat())
+  {
+    case PixelFormat::Indexed:
+      ScaleDownView<P, uint8_t>(dest, src);
+      break;
+    case PixelFormat::Rgb565:
+      ScaleDownView<P, uint16_t>(dest, src);
+      break;
+    case PixelFormat::Rgb24:
+      ScaleDownView<P, Pixel24>(dest, src);
+      break;
+    case PixelFormat::Rgba32:
+      ScaleDownView<P, uint32_t>(dest, src);
+      break;
+  }
+}
+
+#if defined(FRAMEUTIL_SSSE3)
+// Turns every index above 15 into one with the top bit set, which the shuffle resolves to 0.
+inline __m128i ClampIndex16(__m128i index)
+{
+  return _mm_or_si128(index, _mm_cmpgt_epi8(index, _mm_set1_epi8(15)));
+}
+#endif
+
+// Calls f(FixedFrame<width, height>()) if width x height is one of the standard sizes, the static members can then be
+// called on the argument.
+template <typename F>
+inline bool DispatchFixedSize(int width, int height, F&& f)
+{
+  if (width == 128 && height == 32)
+    f(FixedFrame<128, 32>());
+  else if (width == 192 && height == 64)
+    f(FixedFrame<192, 64>());
+  else if (width == 256 && height == 64)
+    f(FixedFrame<256, 64>());
+  else if (width == 384 && height == 128)
+    f(FixedFrame<384, 128>());
+  else if (width == 512 && height == 128)
+    f(FixedFrame<512, 128>());
+  else
+    return false;
+  return true;
+}
+
+}  // namespace Detail
+
+template <int Width, int Height>
+inline void FixedFrame<Width, Height>::Split(uint8_t* pPlanes, uint8_t bitlen, const uint8_t* pFrame)
+{
+  static_assert(Width % 8 == 0, "rows have to be made of whole groups of 8 pixels");
+  int planes = bitlen > 8 ? 8 : bitlen;
+
+  switch (planes)
+  {
+    case 2:
+      Detail::SplitPlanes<2>(pPlanes, pFrame, PlaneSize, PlaneSize, 2);
+      break;
+    case 4:
+      Detail::SplitPlanes<4>(pPlanes, pFrame, PlaneSize, PlaneSize, 4);
+      break;
+    case 6:
+      Detail::SplitPlanes<6>(pPlanes, pFrame, PlaneSize, PlaneSize, 6);
+      break;
+    case 8:
+      Detail::SplitPlanes<8>(pPlanes, pFrame, PlaneSize, PlaneSize, 8);
+      break;
+    default:
+      Detail::SplitPlanes<0>(pPlanes, pFrame, PlaneSize, PlaneSize, planes);
+      break;
+  }
+
+  if (bitlen > planes)
+  {
+    memset(&pPlanes[planes * PlaneSize], 0, (bitlen - planes) * PlaneSize);
+  }
+}
+
+template <int Width, int Height>
+inline void FixedFrame<Width, Height>::Join(uint8_t* pFrame, uint8_t bitlen, const uint8_t* pPlanes)
+{
+  static_assert(Width % 8 == 0, "rows have to be made of whole groups of 8 pixels");
+
+  switch (bitlen > 8 ? 8 : bitlen)
+  {
+    case 2:
+      Detail::JoinPlanes<2>(pFrame, pPlanes, PlaneSize, PlaneSize, 2);
+      break;
+    case 4:
+      Detail::JoinPlanes<4>(pFrame, pPlanes, PlaneSize, PlaneSize, 4);
+      break;
+    case 6:
+      Detail::JoinPlanes<6>(pFrame, pPlanes, PlaneSize, PlaneSize, 6);
+      break;
+    case 8:
+      Detail::JoinPlanes<8>(pFrame, pPlanes, PlaneSize, PlaneSize, 8);
+      break;
+    default:
+      Detail::JoinPlanes<0>(pFrame, pPlanes, PlaneSize, PlaneSize, bitlen);
+      break;
+  }
+}
+
+template <int Width, int Height>
+template <typename T>
+inline void FixedFrame<Width, Height>::ScaleUp(T* pDestFrame, const T* pSrcFrame)
+{
+  for (int y = 0; y < Height; y++)
+  {
+    const T* pRow = &pSrcFrame[y * Width];
+    const T* pAbove = y > 0 ? pRow - Width : pRow;
+    const T* pBelow = y < Height - 1 ? pRow + Width : pRow;
+    T* pDest0 = &pDestFrame[y * 4 * Width];
+
+    Detail::ScaleUpRow(pDest0, pDest0 + Width * 2, pAbove, pRow, pBelow, Width);
+  }
+}
+
+template <int Width, int Height>
+template <typename T>
+inline void FixedFrame<Width, Height>::ScaleDown(T* pDestFrame, const T* pSrcFrame)
+{
+  for (int y = 0; y < Height / 2; y++)
+  {
+    Detail::ScaleDownRow<Detail::ScaleDownPolicy::Quadrant>(&pDestFrame[y * Width / 2], &pSrcFrame[y * 2 * Width],
+                                                            &pSrcFrame[(y * 2 + 1) * Width], Width / 2,
+                                                            y < (Height / 2 + 1) / 2);
+  }
+}
+
+template <int Width, int Height>
+inline void FixedFrame<Width, Height>::ScaleDownIndexed(uint8_t* pDestFrame, const uint8_t* pSrcFrame)
+{
+  for (int y = 0; y < Height / 2; y++)
+  {
+    Detail::ScaleDownRow<Detail::ScaleDownPolicy::QuadrantIndexed>(
+        &pDestFrame[y * Width / 2], &pSrcFrame[y * 2 * Width], &pSrcFrame[(y * 2 + 1) * Width], Width / 2,
+        y < (Height / 2 + 1) / 2);
+  }
+}
+
+template <int Width, int Height>
+inline void FixedFrame<Width, Height>::ScaleDownPUP(uint8_t* pDestFrame, const uint8_t* pSrcFrame)
+{
+  for (int y = 0; y < Height / 2; y++)
+  {
+    Detail::ScaleDownRow<Detail::ScaleDownPolicy::Pup>(&pDestFrame[y * Width / 2], &pSrcFrame[y * 2 * Width],
+                                                       &pSrcFrame[(y * 2 + 1) * Width], Width / 2, true);
+  }
+}
+
+template <int Width, int Height>
+inline const PanelLayout& FixedFrame<Width, Height>::GetPanelLayout(int numLogicalRows, ColorMatrix colorMatrix)
+{
+  // Every valid configuration has a slot, so after the first build a lookup is one load and never waits for the lock,
+  // which only guards building and keeps the layouts of out-of-range row counts.
+  static std::atomic<const PanelLayout*> slots[2][Height + 1];
+  static std::mutex mutex;
+  static std::vector<std::unique_ptr<PanelLayout>> layouts;
+
+  std::atomic<const PanelLayout*>* pSlot =
+      numLogicalRows > 0 && numLogicalRows <= Height ? &slots[(int)colorMatrix][numLogicalRows] : nullptr;
+  if (pSlot)
+  {
+    const PanelLayout* pLayout = pSlot->load(std::memory_order_acquire);
+    if (pLayout) return *pLayout;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const std::unique_ptr<PanelLayout>& pLayout : layouts)
+  {
+    if (pLayout->GetNumLogicalRows() == numLogicalRows && pLayout->GetColorMatrix() == colorMatrix) return *pLayout;
+  }
+  layouts.emplace_back(new PanelLayout(Width, Height, numLogicalRows, colorMatrix));
+  if (pSlot) pSlot->store(layouts.back().get(), std::memory_order_release);
+  return *layouts.back();
+}
+
+inline int Helper::MapAdafruitIndex(int x, int y, int width, int height, int numLogicalRows)
+{
+  int logicalRowLengthPerMatrix = 32 * 32 / 2 / numLogicalRows;
+  int logicalRow = y % numLogicalRows;
+  int dotPairsPerLogicalRow = width * height / numLogicalRows / 2;
+  int widthInMatrices = width / 32;
+  int matrixX = x / 32;
+  int matrixY = y / 32;
+  int totalMatrices = width * height / 1024;
+  int matrixNumber = totalMatrices - ((matrixY + 1) * widthInMatrices) + matrixX;
+  int indexWithinMatrixRow = x % logicalRowLengthPerMatrix;
+  int index = logicalRow * dotPairsPerLogicalRow + matrixNumber * logicalRowLengthPerMatrix + indexWithinMatrixRow;
+  return index;
+}
+
+inline void Helper::Split(uint8_t* pPlanes, uint16_t width, uint16_t height, uint8_t bitlen, uint8_t* pFrame)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Split", (uint64_t)width * height);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().split(pPlanes, width, height, bitlen, pFrame);
+#else
+  int planeSize = width * height / 8;
+  // Pixels only carry 8 bits, any plane above that is empty.
+  int planes = bitlen > 8 ? 8 : bitlen;
+
+  if (Detail::DispatchFixedSize(width, height, [&](auto frame) { frame.Split(pPlanes, bitlen, pFrame); })) return;
+
+  if (width % 8 == 0)
+  {
+    Detail::SplitPlanes(pPlanes, pFrame, planeSize, planeSize, planes);
+
+    if (bitlen > planes)
+    {
+      memset(&pPlanes[planes * planeSize], 0, (bitlen - planes) * planeSize);
+    }
+  }
+  else
+  {
+    // Rows are not made of whole groups of 8 pixels, keep the original per-row walk.
+    int pos = 0;
+    uint8_t bd[8];
+
+    for (int y = 0; y < height; y++)
+    {
+      for (int x = 0; x < width; x += 8)
+      {
+        memset(bd, 0, sizeof(bd));
+
+        for (int v = 7; v >= 0; v--)
         {
-          a[tc] = d[tc] = pSrcFrame[x * bytes - bytes + tc];
-          b[tc] = e[tc] = pSrcFrame[x * bytes + tc];
-          c[tc] = f[tc] = pSrcFrame[x * bytes + bytes + tc];
-          g[tc] = pSrcFrame[row + x * bytes - bytes + tc];
-          h[tc] = pSrcFrame[row + x * bytes + tc];
-          i[tc] = pSrcFrame[row + x * bytes + bytes + tc];
+          uint8_t pixel = pFrame[(y * width) + (x + v)];
+          for (int i = 0; i < planes; i++)
+          {
+            bd[i] <<= 1;
+            if ((pixel & (1 << i)) != 0)
+            {
+              bd[i] |= 1;
+            }
+          }
         }
-        else if (y == srcHeight - 1)
+
+        for (int i = 0; i < bitlen; i++)
         {
-          a[tc] = pSrcFrame[(y - 1) * row + x * bytes - bytes + tc];
-          b[tc] = pSrcFrame[(y - 1) * row + x * bytes + tc];
-          c[tc] = pSrcFrame[(y - 1) * row + x * bytes + bytes + tc];
-          d[tc] = g[tc] = pSrcFrame[y * row + x * bytes - bytes + tc];
-          e[tc] = h[tc] = pSrcFrame[y * row + x * bytes + tc];
-          f[tc] = i[tc] = pSrcFrame[y * row + x * bytes + bytes + tc];
+          pPlanes[i * planeSize + pos] = i < planes ? bd[i] : 0;
         }
-        else
+
+        pos++;
+      }
+    }
+  }
+#endif
+}
+
+inline void Helper::Join(uint8_t* pFrame, uint16_t width, uint16_t height, uint8_t bitlen, const uint8_t* pPlanes)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Join", (uint64_t)width * height / 8 * bitlen);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().join(pFrame, width, height, bitlen, pPlanes);
+#else
+  int planeSize = width * height / 8;
+  // Split() leaves every plane above 8 empty, an indexed pixel can't hold them anyway.
+  int planes = bitlen > 8 ? 8 : bitlen;
+
+  if (Detail::DispatchFixedSize(width, height, [&](auto frame) { frame.Join(pFrame, bitlen, pPlanes); })) return;
+
+  if (width % 8 == 0)
+  {
+    Detail::JoinPlanes(pFrame, pPlanes, planeSize, planeSize, planes);
+  }
+  else
+  {
+    // Mirror the per-row walk of Split(), but never write beyond the end of a row.
+    int pos = 0;
+
+    for (int y = 0; y < height; y++)
+    {
+      for (int x = 0; x < width; x += 8)
+      {
+        for (int v = 0; v < 8 && x + v < width; v++)
         {
-          a[tc] = pSrcFrame[(y - 1) * row + x * bytes - bytes + tc];
-          b[tc] = pSrcFrame[(y - 1) * row + x * bytes + tc];
-          c[tc] = pSrcFrame[(y - 1) * row + x * bytes + bytes + tc];
-          d[tc] = pSrcFrame[y * row + x * bytes - bytes + tc];
-          e[tc] = pSrcFrame[y * row + x * bytes + tc];
-          f[tc] = pSrcFrame[y * row + x * bytes + bytes + tc];
-          g[tc] = pSrcFrame[(y + 1) * row + x * bytes - bytes + tc];
-          h[tc] = pSrcFrame[(y + 1) * row + x * bytes + tc];
-          i[tc] = pSrcFrame[(y + 1) * row + x * bytes + bytes + tc];
+          uint8_t pixel = 0;
+          for (int i = 0; i < planes; i++)
+          {
+            pixel |= ((pPlanes[i * planeSize + pos] >> v) & 1) << i;
+          }
+          pFrame[(y * width) + (x + v)] = pixel;
         }
+
+        pos++;
       }
+    }
+  }
+#endif
+}
+
+inline void Helper::ConvertToRgb24(uint8_t* pFrameRgb24, uint8_t* pFrame, int size, uint8_t* pPalette)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ConvertToRgb24", (uint64_t)size);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().convertToRgb24(pFrameRgb24, pFrame, size, pPalette);
+#else
+  if (size <= 0) return;
+
+  // The palette size is unknown here, so the tables cover the entries up to the highest index in the frame, which are
+  // the ones a plain lookup would read. Set() keeps them as long as that part of the palette doesn't change.
+  uint8_t maxIndex = 0;
+  for (int i = 0; i < size; i++)
+  {
+    maxIndex = pFrame[i] > maxIndex ? pFrame[i] : maxIndex;
+  }
+
+  static thread_local Palette palette;
+  palette.Set(pPalette, maxIndex + 1);
+  palette.ConvertToRgb24(pFrameRgb24, pFrame, size);
+#endif
+}
+
+inline void Helper::SplitIntoRgbPlanes(const uint16_t* rgb565, int rgb565Size, int width, int numLogicalRows,
+                                       uint8_t* dest, ColorMatrix colorMatrix)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::SplitIntoRgbPlanes", (uint64_t)rgb565Size * 2);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().splitIntoRgbPlanes(rgb565, rgb565Size, width, numLogicalRows, dest, (int)colorMatrix);
+#else
+  // The standard sizes use a cached PanelLayout instead of mapping every pixel again.
+  auto splitFixed = [&](auto frame)
+  { SplitIntoRgbPlanes(rgb565, frame.GetPanelLayout(numLogicalRows, colorMatrix), dest); };
+  if (rgb565Size % width == 0 && Detail::DispatchFixedSize(width, rgb565Size / width, splitFixed)) return;
+
+  constexpr int pairOffset = 16;
+  int height = rgb565Size / width;
+  int subframeSize = rgb565Size / 2;
+
+  for (int x = 0; x < width; ++x)
+  {
+    for (int y = 0; y < height; ++y)
+    {
+      if (y % (pairOffset * 2) >= pairOffset) continue;
+
+      int inputIndex0 = y * width + x;
+      int inputIndex1 = inputIndex0 + pairOffset * width;
+
+      uint16_t color0 = rgb565[inputIndex0];
+      uint16_t color1 = rgb565[inputIndex1];
+
+      int r0 = 0, r1 = 0, g0 = 0, g1 = 0, b0 = 0, b1 = 0;
+      switch (colorMatrix)
+      {
+        case ColorMatrix::Rgb:
+          r0 = (color0 >> 13) /*& 0x7*/;
+          g0 = (color0 >> 8) /*& 0x7*/;
+          b0 = (color0 >> 2) /*& 0x7*/;
+          r1 = (color1 >> 13) /*& 0x7*/;
+          g1 = (color1 >> 8) /*& 0x7*/;
+          b1 = (color1 >> 2) /*& 0x7*/;
+          break;
+
+        case ColorMatrix::Rbg:
+          r0 = (color0 >> 13) /*& 0x7*/;
+          b0 = (color0 >> 8) /*& 0x7*/;
+          g0 = (color0 >> 2) /*& 0x7*/;
+          r1 = (color1 >> 13) /*& 0x7*/;
+          b1 = (color1 >> 8) /*& 0x7*/;
+          g1 = (color1 >> 2) /*& 0x7*/;
+          break;
+      }
+
+      for (int subframe = 0; subframe < 3; ++subframe)
+      {
+        uint8_t dotPair = (r0 & 1) << 5 | (g0 & 1) << 4 | (b0 & 1) << 3 | (r1 & 1) << 2 | (g1 & 1) << 1 | (b1 & 1);
+        int indexWithinSubframe = MapAdafruitIndex(x, y, width, height, numLogicalRows);
+        int indexWithinOutput = subframe * subframeSize + indexWithinSubframe;
+        dest[indexWithinOutput] = dotPair;
+        r0 >>= 1;
+        g0 >>= 1;
+        b0 >>= 1;
+        r1 >>= 1;
+        g1 >>= 1;
+        b1 >>= 1;
+      }
+    }
+  }
+#endif
+}
+
+inline void Helper::SplitIntoRgbPlanes(const uint16_t* rgb565, const PanelLayout& layout, uint8_t* dest)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::SplitIntoRgbPlanes", (uint64_t)layout.GetWidth() * layout.GetHeight() * 2);
+  switch (layout.GetColorMatrix())
+  {
+    case ColorMatrix::Rgb:
+      Detail::SplitIntoRgbPlanes<ColorMatrix::Rgb>(rgb565, layout, dest);
+      break;
+
+    case ColorMatrix::Rbg:
+      Detail::SplitIntoRgbPlanes<ColorMatrix::Rbg>(rgb565, layout, dest);
+      break;
+  }
+}
+
+inline void Helper::SplitIntoBcmPlanes(const uint16_t* rgb565, const PanelLayout& layout, const BcmLut& lut,
+                                       uint8_t* dest)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::SplitIntoBcmPlanes", (uint64_t)layout.GetWidth() * layout.GetHeight() * 2);
+  switch (layout.GetColorMatrix())
+  {
+    case ColorMatrix::Rgb:
+      Detail::SplitIntoBcmPlanes<ColorMatrix::Rgb>(rgb565, layout, lut, dest);
+      break;
 
-      if (memcmp(b, h, bytes) != 0 && memcmp(d, f, bytes) != 0)
+    case ColorMatrix::Rbg:
+      Detail::SplitIntoBcmPlanes<ColorMatrix::Rbg>(rgb565, layout, lut, dest);
+      break;
+  }
+}
+
+inline BcmLut::BcmLut(int depth, float brightness, bool brightnessCurve)
+{
+  m_depth = depth < 1 ? 1 : (depth > 8 ? 8 : depth);
+
+  auto build = [&](uint64_t* pTable, int bits)
+  {
+    for (int value = 0; value < (1 << bits); value++)
+    {
+      // Bit replication keeps 0 and full intensity exact, with a linear curve and full brightness the planes hold
+      // the top bits of each channel just like SplitIntoRgbPlanes() does.
+      float level = (float)((value << (8 - bits)) | (value >> (2 * bits - 8)));
+      if (brightnessCurve) level = Helper::CalcBrightness(level / 255.0f) * 255.0f;
+      level *= brightness;
+      int scaled = level <= 0.0f ? 0 : (level >= 255.0f ? 255 : (int)(level + 0.5f));
+      pTable[value] = Detail::UnpackPlane64((uint8_t)(scaled >> (8 - m_depth)));
+    }
+  };
+
+  build(m_red, 5);
+  build(m_green, 6);
+  build(m_blue, 5);
+}
+
+inline PanelLayout::PanelLayout(int width, int height, int numLogicalRows, ColorMatrix colorMatrix)
+    : m_width(width), m_height(height), m_numLogicalRows(numLogicalRows), m_colorMatrix(colorMatrix)
+{
+  constexpr int pairOffset = 16;
+  int subframeSize = GetSubframeSize();
+
+  // Invert the mapping in the order SplitIntoRgbPlanes() visits the pixels, so if two dot pairs share an output byte
+  // the same one wins. Bytes nothing maps to are left untouched, indices outside the subframe are dropped.
+  std::vector<int> source(subframeSize, -1);
+  for (int x = 0; x < width; ++x)
+  {
+    for (int y = 0; y < height; ++y)
+    {
+      if (y % (pairOffset * 2) >= pairOffset) continue;
+
+      int indexWithinSubframe = Helper::MapAdafruitIndex(x, y, width, height, numLogicalRows);
+      if (indexWithinSubframe >= 0 && indexWithinSubframe < subframeSize) source[indexWithinSubframe] = y * width + x;
+    }
+  }
+
+  for (int dest = 0; dest < subframeSize; ++dest)
+  {
+    if (source[dest] < 0) continue;
+
+    if (!m_runs.empty())
+    {
+      Run& last = m_runs.back();
+      if (last.dest + last.length == dest && last.src + last.length == source[dest])
       {
-        memcpy(&pDestFrame[(y * 2 * destWidth + x * 2) * bytes], memcmp(d, b, bytes) == 0 ? d : e, bytes);
-        memcpy(&pDestFrame[(y * 2 * destWidth + x * 2 + 1) * bytes], memcmp(b, f, bytes) == 0 ? f : e, bytes);
-        memcpy(&pDestFrame[((y * 2 + 1) * destWidth + x * 2) * bytes], memcmp(d, h, bytes) == 0 ? d : e, bytes);
-        memcpy(&pDestFrame[((y * 2 + 1) * destWidth + x * 2 + 1) * bytes], memcmp(h, f, bytes) == 0 ? f : e, bytes);
+        last.length++;
+        continue;
       }
-      else
+    }
+    m_runs.push_back({dest, source[dest], 1});
+  }
+}
+
+inline FrameView::FrameView(uint8_t* pData, int width, int height, PixelFormat format, int stride)
+    : m_pData(pData),
+      m_width(width),
+      m_height(height),
+      m_stride(stride != 0 ? stride : width * GetPixelBytes(format)),
+      m_format(format)
+{
+}
+
+inline int FrameView::GetPixelBytes(PixelFormat format)
+{
+  switch (format)
+  {
+    case PixelFormat::Rgb565:
+      return 2;
+    case PixelFormat::Rgb24:
+      return 3;
+    case PixelFormat::Rgba32:
+      return 4;
+    default:
+      return 1;
+  }
+}
+
+inline FrameView FrameView::Crop(int x, int y, int width, int height) const
+{
+  if (x < 0)
+  {
+    width += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    height += y;
+    y = 0;
+  }
+  width = x >= m_width || width < 0 ? 0 : (width > m_width - x ? m_width - x : width);
+  height = y >= m_height || height < 0 ? 0 : (height > m_height - y ? m_height - y : height);
+
+  return FrameView(GetRow(y) + x * GetPixelBytes(), width, height, m_format, m_stride);
+}
+
+inline FrameView FrameView::Center(int width, int height) const
+{
+  return Crop((m_width - width) / 2, (m_height - height) / 2, width, height);
+}
+
+inline void FrameView::Clear() const
+{
+  if (IsPacked())
+  {
+    memset(m_pData, 0, (size_t)m_height * m_stride);
+    return;
+  }
+
+  for (int y = 0; y < m_height; y++)
+  {
+    memset(GetRow(y), 0, m_width * GetPixelBytes());
+  }
+}
+
+inline FrameBuffer::FrameBuffer(int width, int height, PixelFormat format)
+    : m_width(width), m_height(height), m_format(format)
+{
+  m_data.resize((size_t)width * height * FrameView::GetPixelBytes(format));
+}
+
+inline void Palette::Set(const uint8_t* pPalette, int numColors)
+{
+  numColors = numColors < 0 ? 0 : (numColors > 256 ? 256 : numColors);
+  if (numColors == m_numColors && (numColors == 0 || memcmp(m_source, pPalette, numColors * 3) == 0)) return;
+
+  m_numColors = numColors;
+  memset(m_source, 0, sizeof(m_source));
+  if (numColors > 0) memcpy(m_source, pPalette, numColors * 3);
+
+  for (int i = 0; i < 256; i++)
+  {
+    uint8_t r = m_source[i * 3];
+    uint8_t g = m_source[i * 3 + 1];
+    uint8_t b = m_source[i * 3 + 2];
+    uint8_t color[4] = {r, g, b, (uint8_t)(i < numColors ? 0xff : 0)};
+
+    m_red[i] = r;
+    m_green[i] = g;
+    m_blue[i] = b;
+    m_alpha[i] = color[3];
+    m_rgb565[i] = (uint16_t)(((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3));
+    m_rgb565Low[i] = (uint8_t)m_rgb565[i];
+    m_rgb565High[i] = (uint8_t)(m_rgb565[i] >> 8);
+    memcpy(&m_rgba[i], color, 4);
+  }
+  m_rgb565[256] = 0;
+}
+
+inline void Palette::ConvertToRgb24(uint8_t* pFrameRgb24, const uint8_t* pFrame, int size) const
+{
+  int i = 0;
+
+#if defined(FRAMEUTIL_SSSE3)
+  if (m_numColors <= 16)
+  {
+    // Byte n of the 48 output bytes is channel n % 3 of pixel n / 3, 0x80 leaves a byte to the other channels.
+    alignas(16) static const uint8_t interleave[3][3][16] = {
+        {{0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80, 5},
+         {0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80, 0x80},
+         {0x80, 0x80, 0, 0x80, 0x80, 1, 0x80, 0x80, 2, 0x80, 0x80, 3, 0x80, 0x80, 4, 0x80}},
+        {{0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10, 0x80},
+         {5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80, 10},
+         {0x80, 5, 0x80, 0x80, 6, 0x80, 0x80, 7, 0x80, 0x80, 8, 0x80, 0x80, 9, 0x80, 0x80}},
+        {{0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80, 0x80},
+         {0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15, 0x80},
+         {10, 0x80, 0x80, 11, 0x80, 0x80, 12, 0x80, 0x80, 13, 0x80, 0x80, 14, 0x80, 0x80, 15}}};
+    const __m128i red = _mm_load_si128((const __m128i*)m_red);
+    const __m128i green = _mm_load_si128((const __m128i*)m_green);
+    const __m128i blue = _mm_load_si128((const __m128i*)m_blue);
+
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i index = Detail::ClampIndex16(_mm_loadu_si128((const __m128i*)&pFrame[i]));
+      __m128i r = _mm_shuffle_epi8(red, index);
+      __m128i g = _mm_shuffle_epi8(green, index);
+      __m128i b = _mm_shuffle_epi8(blue, index);
+      for (int k = 0; k < 3; k++)
       {
-        memcpy(&pDestFrame[(y * 2 * destWidth + x * 2) * bytes], e, bytes);
-        memcpy(&pDestFrame[(y * 2 * destWidth + x * 2 + 1) * bytes], e, bytes);
-        memcpy(&pDestFrame[((y * 2 + 1) * destWidth + x * 2) * bytes], e, bytes);
-        memcpy(&pDestFrame[((y * 2 + 1) * destWidth + x * 2 + 1) * bytes], e, bytes);
+        __m128i rgb = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(r, _mm_load_si128((const __m128i*)interleave[k][0])),
+                         _mm_shuffle_epi8(g, _mm_load_si128((const __m128i*)interleave[k][1]))),
+            _mm_shuffle_epi8(b, _mm_load_si128((const __m128i*)interleave[k][2])));
+        _mm_storeu_si128((__m128i*)&pFrameRgb24[i * 3 + k * 16], rgb);
       }
     }
   }
+#elif defined(FRAMEUTIL_NEON)
+  if (m_numColors <= 16)
+  {
+    const uint8x8x2_t red = {{vld1_u8(m_red), vld1_u8(&m_red[8])}};
+    const uint8x8x2_t green = {{vld1_u8(m_green), vld1_u8(&m_green[8])}};
+    const uint8x8x2_t blue = {{vld1_u8(m_blue), vld1_u8(&m_blue[8])}};
+
+    for (; i + 8 <= size; i += 8)
+    {
+      uint8x8_t index = vld1_u8(&pFrame[i]);
+      uint8x8x3_t rgb = {{vtbl2_u8(red, index), vtbl2_u8(green, index), vtbl2_u8(blue, index)}};
+      vst3_u8(&pFrameRgb24[i * 3], rgb);
+    }
+  }
+#endif
+
+#if defined(FRAMEUTIL_AVX2)
+  if (m_numColors > 16)
+  {
+    // Gather RGBA and squeeze out the alpha bytes, each half store spills 4 bytes the next one overwrites.
+    const __m256i dropAlpha = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6,
+                                               8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    for (; i + 10 <= size; i += 8)
+    {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&pFrame[i]));
+      __m256i rgb = _mm256_shuffle_epi8(_mm256_i32gather_epi32((const int*)m_rgba, index, 4), dropAlpha);
+      _mm_storeu_si128((__m128i*)&pFrameRgb24[i * 3], _mm256_castsi256_si128(rgb));
+      _mm_storeu_si128((__m128i*)&pFrameRgb24[i * 3 + 12], _mm256_extracti128_si256(rgb, 1));
+    }
+  }
+#endif
+
+  // One 4 byte store per pixel, the spilled alpha byte is overwritten by the next pixel.
+  for (; i + 1 < size; i++)
+  {
+    memcpy(&pFrameRgb24[i * 3], &m_rgba[pFrame[i]], 4);
+  }
+  for (; i < size; i++)
+  {
+    uint8_t index = pFrame[i];
+    pFrameRgb24[i * 3] = m_red[index];
+    pFrameRgb24[i * 3 + 1] = m_green[index];
+    pFrameRgb24[i * 3 + 2] = m_blue[index];
+  }
+}
+
+inline void Palette::ConvertToRgb565(uint16_t* pFrameRgb565, const uint8_t* pFrame, int size) const
+{
+  int i = 0;
+
+#if defined(FRAMEUTIL_SSSE3)
+  if (m_numColors <= 16)
+  {
+    const __m128i low = _mm_load_si128((const __m128i*)m_rgb565Low);
+    const __m128i high = _mm_load_si128((const __m128i*)m_rgb565High);
+
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i index = Detail::ClampIndex16(_mm_loadu_si128((const __m128i*)&pFrame[i]));
+      __m128i l = _mm_shuffle_epi8(low, index);
+      __m128i h = _mm_shuffle_epi8(high, index);
+      _mm_storeu_si128((__m128i*)&pFrameRgb565[i], _mm_unpacklo_epi8(l, h));
+      _mm_storeu_si128((__m128i*)&pFrameRgb565[i + 8], _mm_unpackhi_epi8(l, h));
+    }
+  }
+#elif defined(FRAMEUTIL_NEON)
+  if (m_numColors <= 16)
+  {
+    const uint8x8x2_t low = {{vld1_u8(m_rgb565Low), vld1_u8(&m_rgb565Low[8])}};
+    const uint8x8x2_t high = {{vld1_u8(m_rgb565High), vld1_u8(&m_rgb565High[8])}};
+
+    for (; i + 8 <= size; i += 8)
+    {
+      uint8x8_t index = vld1_u8(&pFrame[i]);
+      uint8x8x2_t rgb565 = {{vtbl2_u8(low, index), vtbl2_u8(high, index)}};
+      vst2_u8((uint8_t*)&pFrameRgb565[i], rgb565);
+    }
+  }
+#endif
+
+#if defined(FRAMEUTIL_AVX2)
+  if (m_numColors > 16)
+  {
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i indices = _mm_loadu_si128((const __m128i*)&pFrame[i]);
+      __m256i a = _mm256_i32gather_epi32((const int*)m_rgb565, _mm256_cvtepu8_epi32(indices), 2);
+      __m256i b = _mm256_i32gather_epi32((const int*)m_rgb565, _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8)), 2);
+      __m256i rgb565 = _mm256_packus_epi32(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+      _mm256_storeu_si256((__m256i*)&pFrameRgb565[i], _mm256_permute4x64_epi64(rgb565, 0xd8));
+    }
+  }
+#endif
+
+  for (; i < size; i++)
+  {
+    pFrameRgb565[i] = m_rgb565[pFrame[i]];
+  }
+}
+
+inline void Palette::ConvertToRgba32(uint8_t* pFrameRgba32, const uint8_t* pFrame, int size) const
+{
+  int i = 0;
+
+#if defined(FRAMEUTIL_SSSE3)
+  if (m_numColors <= 16)
+  {
+    const __m128i red = _mm_load_si128((const __m128i*)m_red);
+    const __m128i green = _mm_load_si128((const __m128i*)m_green);
+    const __m128i blue = _mm_load_si128((const __m128i*)m_blue);
+    const __m128i alpha = _mm_load_si128((const __m128i*)m_alpha);
+
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i index = Detail::ClampIndex16(_mm_loadu_si128((const __m128i*)&pFrame[i]));
+      __m128i r = _mm_shuffle_epi8(red, index);
+      __m128i g = _mm_shuffle_epi8(green, index);
+      __m128i b = _mm_shuffle_epi8(blue, index);
+      __m128i a = _mm_shuffle_epi8(alpha, index);
+      __m128i rg0 = _mm_unpacklo_epi8(r, g);
+      __m128i rg1 = _mm_unpackhi_epi8(r, g);
+      __m128i ba0 = _mm_unpacklo_epi8(b, a);
+      __m128i ba1 = _mm_unpackhi_epi8(b, a);
+      _mm_storeu_si128((__m128i*)&pFrameRgba32[i * 4], _mm_unpacklo_epi16(rg0, ba0));
+      _mm_storeu_si128((__m128i*)&pFrameRgba32[i * 4 + 16], _mm_unpackhi_epi16(rg0, ba0));
+      _mm_storeu_si128((__m128i*)&pFrameRgba32[i * 4 + 32], _mm_unpacklo_epi16(rg1, ba1));
+      _mm_storeu_si128((__m128i*)&pFrameRgba32[i * 4 + 48], _mm_unpackhi_epi16(rg1, ba1));
+    }
+  }
+#elif defined(FRAMEUTIL_NEON)
+  if (m_numColors <= 16)
+  {
+    const uint8x8x2_t red = {{vld1_u8(m_red), vld1_u8(&m_red[8])}};
+    const uint8x8x2_t green = {{vld1_u8(m_green), vld1_u8(&m_green[8])}};
+    const uint8x8x2_t blue = {{vld1_u8(m_blue), vld1_u8(&m_blue[8])}};
+    const uint8x8x2_t alpha = {{vld1_u8(m_alpha), vld1_u8(&m_alpha[8])}};
+
+    for (; i + 8 <= size; i += 8)
+    {
+      uint8x8_t index = vld1_u8(&pFrame[i]);
+      uint8x8x4_t rgba = {
+          {vtbl2_u8(red, index), vtbl2_u8(green, index), vtbl2_u8(blue, index), vtbl2_u8(alpha, index)}};
+      vst4_u8(&pFrameRgba32[i * 4], rgba);
+    }
+  }
+#endif
+
+#if defined(FRAMEUTIL_AVX2)
+  if (m_numColors > 16)
+  {
+    for (; i + 8 <= size; i += 8)
+    {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&pFrame[i]));
+      _mm256_storeu_si256((__m256i*)&pFrameRgba32[i * 4], _mm256_i32gather_epi32((const int*)m_rgba, index, 4));
+    }
+  }
+#endif
+
+  for (; i < size; i++)
+  {
+    memcpy(&pFrameRgba32[i * 4], &m_rgba[pFrame[i]], 4);
+  }
+}
+
+inline void Palette::Convert(const FrameView& dest, const FrameView& src) const
+{
+  if (src.GetFormat() != PixelFormat::Indexed || dest.GetWidth() < src.GetWidth() ||
+      dest.GetHeight() < src.GetHeight())
+    return;
+
+  // Packed frames of the same width are converted in one go.
+  bool packed = src.IsPacked() && dest.IsPacked() && dest.GetWidth() == src.GetWidth();
+  int width = packed ? src.GetWidth() * src.GetHeight() : src.GetWidth();
+  int height = packed ? 1 : src.GetHeight();
+
+  for (int y = 0; y < height; y++)
+  {
+    switch (dest.GetFormat())
+    {
+      case PixelFormat::Rgb565:
+        ConvertToRgb565((uint16_t*)dest.GetRow(y), src.GetRow(y), width);
+        break;
+      case PixelFormat::Rgb24:
+        ConvertToRgb24(dest.GetRow(y), src.GetRow(y), width);
+        break;
+      case PixelFormat::Rgba32:
+        ConvertToRgba32(dest.GetRow(y), src.GetRow(y), width);
+        break;
+      default:
+        return;
+    }
+  }
+}
+
+inline float Helper::CalcBrightness(float x)
+{
+  // function to improve the brightness with fx=ax²+bc+c, f(0)=0, f(1)=1, f'(1.1)=0
+  return (-x * x + 2.1f * x) / 1.1f;
+}
+
+inline void Helper::ScaleDownIndexed(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
+                                     const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDownIndexed", (uint64_t)srcWidth * srcHeight);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().scaleDownIndexed(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight);
+#else
+  // for half scaling we take the 4 points and look if there is one color repeated
+  auto scaleDownFixed = [&](auto frame) { frame.ScaleDownIndexed(pDestFrame, pSrcFrame); };
+  if (destWidth * 2 == srcWidth && destHeight * 2 == srcHeight &&
+      Detail::DispatchFixedSize(srcWidth, srcHeight, scaleDownFixed))
+    return;
+
+  Detail::ScaleDown<Detail::ScaleDownPolicy::QuadrantIndexed>(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth,
+                                                              srcHeight);
+#endif
+}
+
+inline void Helper::ScaleDownPUP(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
+                                 const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDownPUP", (uint64_t)srcWidth * srcHeight);
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  Dispatch::GetKernels().scaleDownPup(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight);
+#else
+  if (destWidth * 2 == srcWidth && destHeight * 2 == srcHeight &&
+      Detail::DispatchFixedSize(srcWidth, srcHeight, [&](auto frame) { frame.ScaleDownPUP(pDestFrame, pSrcFrame); }))
+    return;
+
+  Detail::ScaleDown<Detail::ScaleDownPolicy::Pup>(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight);
+#endif
+}
+
+inline void Helper::ScaleDown(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
+                              const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight, uint8_t bits)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDown", (uint64_t)srcWidth * srcHeight * (bits / 8));
+  switch (bits)
+  {
+    case 8:
+      ScaleDown<uint8_t>(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 16:
+      ScaleDown<uint16_t>((uint16_t*)pDestFrame, destWidth, destHeight, (const uint16_t*)pSrcFrame, srcWidth,
+                          srcHeight);
+      break;
+
+    case 24:
+      ScaleDown<Pixel24>((Pixel24*)pDestFrame, destWidth, destHeight, (const Pixel24*)pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 32:
+      ScaleDown<uint32_t>((uint32_t*)pDestFrame, destWidth, destHeight, (const uint32_t*)pSrcFrame, srcWidth,
+                          srcHeight);
+      break;
+  }
+}
+
+template <typename T>
+inline void Helper::ScaleDown(T* pDestFrame, const uint16_t destWidth, const uint16_t destHeight, const T* pSrcFrame,
+                              const uint16_t srcWidth, const uint16_t srcHeight)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDown", (uint64_t)srcWidth * srcHeight * sizeof(T));
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  if (sizeof(T) <= 4)
+  {
+    Dispatch::GetKernels().scaleDown((uint8_t*)pDestFrame, destWidth, destHeight, (const uint8_t*)pSrcFrame, srcWidth,
+                                     srcHeight, sizeof(T) * 8);
+    return;
+  }
+#endif
+
+  if (destWidth * 2 == srcWidth && destHeight * 2 == srcHeight &&
+      Detail::DispatchFixedSize(srcWidth, srcHeight, [&](auto frame) { frame.ScaleDown(pDestFrame, pSrcFrame); }))
+    return;
+
+  Detail::ScaleDown<Detail::ScaleDownPolicy::Quadrant>(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth,
+                                                       srcHeight);
+}
+
+inline void Helper::ScaleUp(uint8_t* pDestFrame, const uint8_t* pSrcFrame, const uint16_t srcWidth,
+                            const uint8_t srcHeight, uint8_t bits)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleUp", (uint64_t)srcWidth * srcHeight * (bits / 8));
+  switch (bits)
+  {
+    case 8:
+      ScaleUp<uint8_t>(pDestFrame, pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 16:
+      ScaleUp<uint16_t>((uint16_t*)pDestFrame, (const uint16_t*)pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 24:
+      ScaleUp<Pixel24>((Pixel24*)pDestFrame, (const Pixel24*)pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 32:
+      ScaleUp<uint32_t>((uint32_t*)pDestFrame, (const uint32_t*)pSrcFrame, srcWidth, srcHeight);
+      break;
+  }
+}
+
+template <typename T>
+inline void Helper::ScaleUp(T* pDestFrame, const T* pSrcFrame, const uint16_t srcWidth, const uint16_t srcHeight)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleUp", (uint64_t)srcWidth * srcHeight * sizeof(T));
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  if (sizeof(T) <= 4)
+  {
+    Dispatch::GetKernels().scaleUp((uint8_t*)pDestFrame, (const uint8_t*)pSrcFrame, srcWidth, srcHeight, sizeof(T) * 8);
+    return;
+  }
+#endif
+
+  // we implement scale2x http://www.scale2x.it/algorithm
+  // Pixels outside the frame are replaced by the nearest edge pixel.
+  if (srcWidth == 0) return;
+  if (Detail::DispatchFixedSize(srcWidth, srcHeight, [&](auto frame) { frame.ScaleUp(pDestFrame, pSrcFrame); })) return;
+  int destWidth = srcWidth * 2;
+
+  for (int y = 0; y < srcHeight; y++)
+  {
+    const T* pRow = &pSrcFrame[y * srcWidth];
+    const T* pAbove = y > 0 ? pRow - srcWidth : pRow;
+    const T* pBelow = y < srcHeight - 1 ? pRow + srcWidth : pRow;
+    T* pDest0 = &pDestFrame[y * 2 * destWidth];
 
-  free(a);
-  free(b);
-  free(c);
-  free(d);
-  free(e);
-  free(f);
-  free(g);
-  free(h);
-  free(i);
+    Detail::ScaleUpRow(pDest0, pDest0 + destWidth, pAbove, pRow, pBelow, srcWidth);
+  }
 }
 
 inline void Helper::ScaleUpIndexed(uint8_t* pDestFrame, const uint8_t* pSrcFrame, const uint16_t srcWidth,
                                    const uint8_t srcHeight)
 {
-  ScaleUp(pDestFrame, pSrcFrame, srcWidth, srcHeight, 8);
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleUpIndexed", (uint64_t)srcWidth * srcHeight);
+  ScaleUp<uint8_t>(pDestFrame, pSrcFrame, srcWidth, srcHeight);
 }
 
 inline void Helper::Center(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
                            const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight, uint8_t bits)
 {
-  uint8_t xOffset = (destWidth - srcWidth) / 2;
-  uint8_t yOffset = (destHeight - srcHeight) / 2;
-  uint8_t bytes = bits / 8;  // RGB24 (3 byte) or RGB16 (2 byte) or indexed (1 byte)
+  FRAMEUTIL_HELPER_SCOPE("Helper::Center", (uint64_t)srcWidth * srcHeight * (bits / 8));
+  int xOffset = (destWidth - srcWidth) / 2;
+  int yOffset = (destHeight - srcHeight) / 2;
+  int bytes = bits / 8;  // RGB24 (3 byte) or RGB16 (2 byte) or indexed (1 byte)
 
   memset(pDestFrame, 0, destWidth * destHeight * bytes);
 
-  for (uint8_t y = 0; y < srcHeight; y++)
+  for (int y = 0; y < srcHeight; y++)
   {
     memcpy(&pDestFrame[((yOffset + y) * destWidth + xOffset) * bytes], &pSrcFrame[y * srcWidth * bytes],
            srcWidth * bytes);
@@ -541,7 +2165,152 @@ inline void Helper::Center(uint8_t* pDestFrame, const uint16_t destWidth, const
 inline void Helper::CenterIndexed(uint8_t* pDestFrame, const uint16_t destWidth, const uint8_t destHeight,
                                   const uint8_t* pSrcFrame, const uint16_t srcWidth, const uint8_t srcHeight)
 {
+  FRAMEUTIL_HELPER_SCOPE("Helper::CenterIndexed", (uint64_t)srcWidth * srcHeight);
   Center(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight, 8);
 }
 
+inline void Helper::ConvertToRgb24(const FrameView& dest, const FrameView& src, const uint8_t* pPalette)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ConvertToRgb24", (uint64_t)src.GetWidth() * src.GetHeight());
+  if (src.GetFormat() != PixelFormat::Indexed || dest.GetFormat() != PixelFormat::Rgb24 ||
+      dest.GetWidth() < src.GetWidth() || dest.GetHeight() < src.GetHeight())
+    return;
+
+  // Packed frames of the same width are converted in one go, others row by row.
+  bool packed = src.IsPacked() && dest.IsPacked() && dest.GetWidth() == src.GetWidth();
+  int width = packed ? src.GetWidth() * src.GetHeight() : src.GetWidth();
+  int height = packed ? 1 : src.GetHeight();
+
+  // The pointer overload only reads the palette, it just predates const.
+  for (int y = 0; y < height; y++)
+  {
+    ConvertToRgb24(dest.GetRow(y), src.GetRow(y), width, const_cast<uint8_t*>(pPalette));
+  }
+}
+
+inline void Helper::Split(uint8_t* pPlanes, uint8_t bitlen, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Split", (uint64_t)src.GetWidth() * src.GetHeight());
+  int width = src.GetWidth();
+  int planeSize = width * src.GetHeight() / 8;
+  int planes = bitlen > 8 ? 8 : bitlen;
+
+  if (src.GetFormat() != PixelFormat::Indexed) return;
+  if (src.IsPacked())
+  {
+    Split(pPlanes, width, src.GetHeight(), bitlen, src.GetData());
+    return;
+  }
+  // Rows of strided views have to be made of whole groups of 8 pixels.
+  if (width % 8 != 0) return;
+
+  for (int y = 0; y < src.GetHeight(); y++)
+  {
+    Detail::SplitPlanes(&pPlanes[y * width / 8], src.GetRow(y), planeSize, width / 8, planes);
+  }
+  if (bitlen > planes)
+  {
+    memset(&pPlanes[planes * planeSize], 0, (bitlen - planes) * planeSize);
+  }
+}
+
+inline void Helper::Join(const FrameView& dest, uint8_t bitlen, const uint8_t* pPlanes)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Join", (uint64_t)dest.GetWidth() * dest.GetHeight() / 8 * bitlen);
+  int width = dest.GetWidth();
+  int planeSize = width * dest.GetHeight() / 8;
+  int planes = bitlen > 8 ? 8 : bitlen;
+
+  if (dest.GetFormat() != PixelFormat::Indexed) return;
+  if (dest.IsPacked())
+  {
+    Join(dest.GetData(), width, dest.GetHeight(), bitlen, pPlanes);
+    return;
+  }
+  if (width % 8 != 0) return;
+
+  for (int y = 0; y < dest.GetHeight(); y++)
+  {
+    Detail::JoinPlanes(dest.GetRow(y), &pPlanes[y * width / 8], planeSize, width / 8, planes);
+  }
+}
+
+inline void Helper::ScaleDown(const FrameView& dest, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDown", (uint64_t)src.GetWidth() * src.GetHeight() * src.GetPixelBytes());
+  Detail::ScaleDownView<Detail::ScaleDownPolicy::Quadrant>(dest, src);
+}
+
+inline void Helper::ScaleDownPUP(const FrameView& dest, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleDownPUP", (uint64_t)src.GetWidth() * src.GetHeight());
+  Detail::ScaleDownView<Detail::ScaleDownPolicy::Pup>(dest, src);
+}
+
+inline void Helper::ScaleUp(const FrameView& dest, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::ScaleUp", (uint64_t)src.GetWidth() * src.GetHeight() * src.GetPixelBytes());
+  if (dest.GetFormat() != src.GetFormat() || dest.GetWidth() < src.GetWidth() * 2 ||
+      dest.GetHeight() < src.GetHeight() * 2)
+    return;
+
+  switch (src.GetFormat())
+  {
+    case PixelFormat::Indexed:
+      Detail::ScaleUpView<uint8_t>(dest, src);
+      break;
+    case PixelFormat::Rgb565:
+      Detail::ScaleUpView<uint16_t>(dest, src);
+      break;
+    case PixelFormat::Rgb24:
+      Detail::ScaleUpView<Pixel24>(dest, src);
+      break;
+    case PixelFormat::Rgba32:
+      Detail::ScaleUpView<uint32_t>(dest, src);
+      break;
+  }
+}
+
+inline void Helper::Copy(const FrameView& dest, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Copy", (uint64_t)src.GetWidth() * src.GetHeight() * src.GetPixelBytes());
+  if (dest.GetFormat() != src.GetFormat()) return;
+
+  int width = dest.GetWidth() < src.GetWidth() ? dest.GetWidth() : src.GetWidth();
+  int height = dest.GetHeight() < src.GetHeight() ? dest.GetHeight() : src.GetHeight();
+  for (int y = 0; y < height; y++)
+  {
+    memcpy(dest.GetRow(y), src.GetRow(y), width * src.GetPixelBytes());
+  }
+}
+
+inline void Helper::Center(const FrameView& dest, const FrameView& src)
+{
+  FRAMEUTIL_HELPER_SCOPE("Helper::Center", (uint64_t)src.GetWidth() * src.GetHeight() * src.GetPixelBytes());
+  if (dest.GetFormat() != src.GetFormat()) return;
+
+  int xOffset = dest.GetWidth() > src.GetWidth() ? (dest.GetWidth() - src.GetWidth()) / 2 : 0;
+  int yOffset = dest.GetHeight() > src.GetHeight() ? (dest.GetHeight() - src.GetHeight()) / 2 : 0;
+  int bytes = dest.GetPixelBytes();
+  FrameView inner = dest.Crop(xOffset, yOffset, src.GetWidth(), src.GetHeight());
+
+  for (int y = 0; y < dest.GetHeight(); y++)
+  {
+    uint8_t* pRow = dest.GetRow(y);
+    if (y < yOffset || y >= yOffset + inner.GetHeight())
+    {
+      memset(pRow, 0, dest.GetWidth() * bytes);
+      continue;
+    }
+    memset(pRow, 0, xOffset * bytes);
+    memset(&pRow[(xOffset + inner.GetWidth()) * bytes], 0, (dest.GetWidth() - xOffset - inner.GetWidth()) * bytes);
+  }
+
+  Copy(inner, src.Center(inner.GetWidth(), inner.GetHeight()));
+}
+
+#if defined(FRAMEUTIL_ISA_NAMESPACE)
+}  // namespace FRAMEUTIL_ISA_NAMESPACE
+#endif
+
 }  // namespace FrameUtil
@@ -0,0 +1,121 @@
+#include "Kernels.h"
+
+#include <cstdlib>
+
+#include "FrameUtil.h"
+
+#if defined(FRAMEUTIL_KERNELS_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(FRAMEUTIL_KERNELS_ARM) && defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+namespace FrameUtil
+{
+namespace Dispatch
+{
+namespace
+{
+
+#if defined(FRAMEUTIL_KERNELS_X86)
+void CpuId(int leaf, int regs[4])
+{
+#if defined(_MSC_VER)
+  __cpuidex(regs, leaf, 0);
+#else
+  unsigned int a, b, c, d;
+  __cpuid_count(leaf, 0, a, b, c, d);
+  regs[0] = (int)a;
+  regs[1] = (int)b;
+  regs[2] = (int)c;
+  regs[3] = (int)d;
+#endif
+}
+
+bool HasAvx2()
+{
+  int regs[4];
+  CpuId(0, regs);
+  if (regs[0] < 7) return false;
+
+  // The CPU has to support AVX and XSAVE, and the OS has to save the YMM registers.
+  CpuId(1, regs);
+  if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0) return false;
+#if defined(_MSC_VER)
+  uint64_t xcr0 = _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  uint64_t xcr0 = ((uint64_t)edx << 32) | eax;
+#endif
+  if ((xcr0 & 6) != 6) return false;
+
+  CpuId(7, regs);
+  return (regs[1] & (1 << 5)) != 0;
+}
+#endif
+
+#if defined(FRAMEUTIL_KERNELS_ARM)
+bool HasNeon()
+{
+#if defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+  return true;
+#elif defined(__linux__)
+  // HWCAP_NEON of 32-bit ARM Linux.
+  return (getauxval(AT_HWCAP) & (1 << 12)) != 0;
+#else
+  return false;
+#endif
+}
+#endif
+
+const Kernels& Select()
+{
+  struct Candidate
+  {
+    const Kernels& kernels;
+    bool supported;
+  };
+
+  // Best first.
+  const Candidate candidates[] = {
+#if defined(FRAMEUTIL_KERNELS_X86)
+      {GetAvx2Kernels(), HasAvx2()},
+      {GetSse2Kernels(), true},
+#endif
+#if defined(FRAMEUTIL_KERNELS_ARM)
+      {GetNeonKernels(), HasNeon()},
+#endif
+      {GetScalarKernels(), true},
+  };
+
+  const char* pForced = getenv("FRAMEUTIL_ISA");
+  if (pForced)
+  {
+    for (const Candidate& candidate : candidates)
+    {
+      if (candidate.supported && strcmp(candidate.kernels.name, pForced) == 0) return candidate.kernels;
+    }
+  }
+
+  for (const Candidate& candidate : candidates)
+  {
+    if (candidate.supported) return candidate.kernels;
+  }
+  return GetScalarKernels();
+}
+
+}  // namespace
+
+const Kernels& GetKernels()
+{
+  static const Kernels& kernels = Select();
+  return kernels;
+}
+
+}  // namespace Dispatch
+}  // namespace FrameUtil
@@ -0,0 +1,41 @@
+#pragma once
+
+// Shared by the dispatcher and the per-ISA kernel builds. Nothing in here may include FrameUtil.h, the kernel builds
+// have to enable their instruction set between the standard headers and FrameUtil.h.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Has no kernels, but its inline functions must not be built for a wider instruction set either.
+#include "FrameStats.h"
+
+// Every source is compiled for every architecture, e.g. for universal binaries, and builds what fits.
+#if defined(__x86_64__) || defined(_M_X64)
+#define FRAMEUTIL_KERNELS_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__arm__)
+#define FRAMEUTIL_KERNELS_ARM
+#endif
+
+namespace FrameUtil
+{
+namespace Dispatch
+{
+
+struct Kernels;
+
+const Kernels& GetScalarKernels();
+#if defined(FRAMEUTIL_KERNELS_X86)
+const Kernels& GetSse2Kernels();
+const Kernels& GetAvx2Kernels();
+#endif
+#if defined(FRAMEUTIL_KERNELS_ARM)
+const Kernels& GetNeonKernels();
+#endif
+
+}  // namespace Dispatch
+}  // namespace FrameUtil
@@ -0,0 +1,86 @@
+// Kernel table of one ISA build, included by its translation unit right after FrameUtil.h was compiled into namespace
+// FRAMEUTIL_ISA_NAMESPACE.
+
+namespace FrameUtil
+{
+namespace FRAMEUTIL_ISA_NAMESPACE
+{
+namespace
+{
+
+void SplitIntoRgbPlanes(const uint16_t* rgb565, int rgb565Size, int width, int numLogicalRows, uint8_t* dest,
+                        int colorMatrix)
+{
+  Helper::SplitIntoRgbPlanes(rgb565, rgb565Size, width, numLogicalRows, dest, (ColorMatrix)colorMatrix);
+}
+
+void ScaleDown(uint8_t* pDestFrame, uint16_t destWidth, uint16_t destHeight, const uint8_t* pSrcFrame,
+               uint16_t srcWidth, uint16_t srcHeight, uint8_t bits)
+{
+  switch (bits)
+  {
+    case 8:
+      Helper::ScaleDown<uint8_t>(pDestFrame, destWidth, destHeight, pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 16:
+      Helper::ScaleDown<uint16_t>((uint16_t*)pDestFrame, destWidth, destHeight, (const uint16_t*)pSrcFrame, srcWidth,
+                                  srcHeight);
+      break;
+
+    case 24:
+      Helper::ScaleDown<Pixel24>((Pixel24*)pDestFrame, destWidth, destHeight, (const Pixel24*)pSrcFrame, srcWidth,
+                                 srcHeight);
+      break;
+
+    case 32:
+      Helper::ScaleDown<uint32_t>((uint32_t*)pDestFrame, destWidth, destHeight, (const uint32_t*)pSrcFrame, srcWidth,
+                                  srcHeight);
+      break;
+  }
+}
+
+void ScaleUp(uint8_t* pDestFrame, const uint8_t* pSrcFrame, uint16_t srcWidth, uint16_t srcHeight, uint8_t bits)
+{
+  switch (bits)
+  {
+    case 8:
+      Helper::ScaleUp<uint8_t>(pDestFrame, pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 16:
+      Helper::ScaleUp<uint16_t>((uint16_t*)pDestFrame, (const uint16_t*)pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 24:
+      Helper::ScaleUp<Pixel24>((Pixel24*)pDestFrame, (const Pixel24*)pSrcFrame, srcWidth, srcHeight);
+      break;
+
+    case 32:
+      Helper::ScaleUp<uint32_t>((uint32_t*)pDestFrame, (const uint32_t*)pSrcFrame, srcWidth, srcHeight);
+      break;
+  }
+}
+
+}  // namespace
+}  // namespace FRAMEUTIL_ISA_NAMESPACE
+
+namespace Dispatch
+{
+
+const Kernels& FRAMEUTIL_KERNELS_GETTER()
+{
+  static const Kernels kernels = {FRAMEUTIL_KERNELS_NAME,
+                                  &FRAMEUTIL_ISA_NAMESPACE::Helper::ConvertToRgb24,
+                                  &FRAMEUTIL_ISA_NAMESPACE::Helper::Split,
+                                  &FRAMEUTIL_ISA_NAMESPACE::Helper::Join,
+                                  &FRAMEUTIL_ISA_NAMESPACE::SplitIntoRgbPlanes,
+                                  &FRAMEUTIL_ISA_NAMESPACE::Helper::ScaleDownIndexed,
+                                  &FRAMEUTIL_ISA_NAMESPACE::Helper::ScaleDownPUP,
+                                  &FRAMEUTIL_ISA_NAMESPACE::ScaleDown,
+                                  &FRAMEUTIL_ISA_NAMESPACE::ScaleUp};
+  return kernels;
+}
+
+}  // namespace Dispatch
+}  // namespace FrameUtil
@@ -0,0 +1,27 @@
+// AVX2 build of the kernels. The instruction set is enabled after the standard headers, so their inline functions
+// and templates stay at the baseline and the linker can't pick an AVX2 copy of them for code that runs everywhere.
+// MSVC needs no switch, its intrinsics are always available and it only auto-vectorizes for AVX2 with /arch:AVX2.
+
+#include "Kernels.h"
+
+#if defined(FRAMEUTIL_KERNELS_X86)
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#define FRAMEUTIL_FORCE_AVX2
+#define FRAMEUTIL_ISA_NAMESPACE Avx2
+#define FRAMEUTIL_KERNELS_NAME "avx2"
+#define FRAMEUTIL_KERNELS_GETTER GetAvx2Kernels
+#include "FrameUtil.h"
+#include "Kernels.inl"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
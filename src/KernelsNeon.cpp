@@ -0,0 +1,31 @@
+// NEON build of the kernels. It is the baseline on AArch64, 32-bit ARM builds enable it for this code only, so one
+// binary runs on boards with and without NEON. See KernelsAvx2.cpp for why the standard headers come first.
+
+#include "Kernels.h"
+
+#if defined(FRAMEUTIL_KERNELS_ARM)
+#if !defined(__ARM_NEON) && !defined(_M_ARM64)
+#define FRAMEUTIL_KERNELS_ENABLE_NEON
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("neon"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("fpu=neon")
+#endif
+#define FRAMEUTIL_FORCE_NEON
+#endif
+
+#define FRAMEUTIL_ISA_NAMESPACE Neon
+#define FRAMEUTIL_KERNELS_NAME "neon"
+#define FRAMEUTIL_KERNELS_GETTER GetNeonKernels
+#include "FrameUtil.h"
+#include "Kernels.inl"
+
+#if defined(FRAMEUTIL_KERNELS_ENABLE_NEON)
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#endif
+#endif
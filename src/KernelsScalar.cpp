@@ -0,0 +1,10 @@
+// Portable build of the kernels, always available.
+
+#include "Kernels.h"
+
+#define FRAMEUTIL_NO_SIMD
+#define FRAMEUTIL_ISA_NAMESPACE Scalar
+#define FRAMEUTIL_KERNELS_NAME "scalar"
+#define FRAMEUTIL_KERNELS_GETTER GetScalarKernels
+#include "FrameUtil.h"
+#include "Kernels.inl"
@@ -0,0 +1,11 @@
+// SSE2 build of the kernels, the x86-64 baseline.
+
+#include "Kernels.h"
+
+#if defined(FRAMEUTIL_KERNELS_X86)
+#define FRAMEUTIL_ISA_NAMESPACE Sse2
+#define FRAMEUTIL_KERNELS_NAME "sse2"
+#define FRAMEUTIL_KERNELS_GETTER GetSse2Kernels
+#include "FrameUtil.h"
+#include "Kernels.inl"
+#endif
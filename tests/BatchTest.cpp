@@ -0,0 +1,116 @@
+// Checks that FrameBatch gives the same output as converting frame by frame, for any number of threads, and reports
+// how the throughput scales.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameBatch.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+struct Conversion
+{
+  const char* name;
+  PixelFormat format;
+  bool panel;  // HUB75 subframes instead of pixels in format
+  uint16_t width;
+  uint16_t height;
+  ScaleMode mode;
+};
+
+}  // namespace
+
+int main()
+{
+  const int width = 128;
+  const int height = 32;
+  const size_t count = 4000;
+
+  // A dump of slowly changing frames, every fourth one repeats its predecessor like real recordings do.
+  std::vector<uint8_t> frames(count * width * height);
+  uint64_t state = 17;
+  for (size_t i = 0; i < count; i++)
+  {
+    uint8_t* pFrame = &frames[i * width * height];
+    if (i > 0 && i % 4 == 0)
+    {
+      memcpy(pFrame, pFrame - width * height, width * height);
+      continue;
+    }
+    for (int p = 0; p < width * height; p++)
+    {
+      pFrame[p] = (uint8_t)(Test::SplitMix64(state) % 4);
+    }
+  }
+
+  const Conversion conversions[] = {
+      {"ScaleUp/Rgb24", PixelFormat::Rgb24, false, 256, 64, ScaleMode::ScaleUp},
+      {"ScaleUp/RgbPlanes", PixelFormat::Rgb565, true, 256, 64, ScaleMode::ScaleUp},
+      {"Center/Rgb565", PixelFormat::Rgb565, false, 192, 64, ScaleMode::Center},
+  };
+  const uint8_t palette[] = {0, 0, 0, 85, 30, 0, 170, 60, 0, 255, 88, 32};
+
+  for (const Conversion& conversion : conversions)
+  {
+    FramePipeline pipeline;
+    pipeline.SetSource(PixelFormat::Indexed, width, height);
+    pipeline.SetPalette(palette, 4);
+    pipeline.SetScaleMode(conversion.mode);
+    if (conversion.panel)
+      pipeline.SetTarget(PlaneFormat::RgbPlanes, conversion.width, conversion.height);
+    else
+      pipeline.SetTarget(conversion.format, conversion.width, conversion.height);
+    pipeline.SetCacheSize(4);
+    size_t targetSize = pipeline.GetTargetSize();
+
+    std::vector<uint8_t> expected(count * targetSize);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++)
+    {
+      pipeline.Process(&frames[i * width * height], &expected[i * targetSize]);
+    }
+    double sequential = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%-20s sequential %8.2f ms\n", conversion.name, sequential);
+
+    for (int threads : {1, 2, 3, 8, 0})
+    {
+      FrameBatch batch(threads);
+      std::vector<uint8_t> output(count * targetSize, 0xcd);
+      start = std::chrono::steady_clock::now();
+      bool valid = batch.Convert(pipeline, frames.data(), output.data(), count);
+      double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      bool same = valid && output == expected;
+      printf("%-20s %2d threads %8.2f ms %5.2fx %s\n", conversion.name, batch.GetNumThreads(), elapsed,
+             sequential / elapsed, same ? "OK" : "MISMATCH");
+      Test::Check(same, "batch output matches the sequential one");
+    }
+  }
+
+  // Every index runs exactly once, on a worker that owns its scratch buffer meanwhile.
+  FrameBatch batch(4);
+  std::vector<int> runs(10007);
+  batch.Run(runs.size(),
+            [&](size_t index, int worker)
+            {
+              uint8_t* pScratch = batch.GetScratch(worker, 64);
+              memset(pScratch, (int)index, 64);
+              runs[index] += pScratch[63] == (uint8_t)index ? 1 : 100;
+            });
+  for (size_t i = 0; i < runs.size(); i++)
+  {
+    if (!Test::Check(runs[i] == 1, "Run() runs every index once"))
+    {
+      printf("index %d ran %d times\n", (int)i, runs[i]);
+      break;
+    }
+  }
+
+  return Test::Report();
+}
@@ -0,0 +1,149 @@
+// Times every Helper kernel at the standard DMD sizes over the synthetic corpus and optionally recorded frames.
+//
+//   frameutil_bench [--filter <text>] [--dump <file>]... [--json <file>] [--min-time <ms>]
+//
+// Recorded frames come from binary dumps or DMDExt text dumps of indexed frames, see FrameDump.h. Reports ns per frame
+// and the throughput of input plus output bytes. With FRAMEUTIL_ISA the kernels of the library can be compared on the
+// same machine.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Corpus.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+struct Result
+{
+  std::string name;
+  int frames;
+  double nsPerFrame;
+  double gbPerSecond;
+};
+
+// Cycles through the corpus until minTime has passed and keeps the best of five such runs.
+Result Measure(const Test::Case& testCase, const std::vector<Test::CorpusFrame>& corpus, double minTime)
+{
+  using Clock = std::chrono::steady_clock;
+
+  std::vector<std::vector<uint8_t>> inputs;
+  for (const Test::CorpusFrame& frame : corpus)
+  {
+    inputs.emplace_back(frame.Get(testCase.bytesPerPixel), frame.Get(testCase.bytesPerPixel) + testCase.inputSize);
+  }
+  std::vector<uint8_t> output(testCase.outputSize);
+
+  // Warm up caches and the lazily built tables.
+  for (const auto& input : inputs) testCase.run(output.data(), input.data());
+
+  double best = 0.0;
+  for (int repetition = 0; repetition < 5; repetition++)
+  {
+    long frames = 0;
+    double elapsed = 0.0;
+    Clock::time_point start = Clock::now();
+    do
+    {
+      for (const auto& input : inputs) testCase.run(output.data(), input.data());
+      frames += (long)inputs.size();
+      elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    } while (elapsed < minTime * 1e6);
+
+    double nsPerFrame = elapsed / frames;
+    if (repetition == 0 || nsPerFrame < best) best = nsPerFrame;
+  }
+
+  return {testCase.name, (int)inputs.size(), best, (testCase.inputSize + testCase.outputSize) / best};
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  std::string filter;
+  std::vector<const char*> dumps;
+  const char* pJson = nullptr;
+  double minTime = 20.0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+      filter = argv[++i];
+    else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+      dumps.push_back(argv[++i]);
+    else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+      pJson = argv[++i];
+    else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+      minTime = atof(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--filter <text>] [--dump <file>]... [--json <file>] [--min-time <ms>]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  const char* pKernels = "header";
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  pKernels = Dispatch::GetKernels().name;
+#endif
+  printf("frameutil %s, kernels: %s\n", FRAMEUTIL_VERSION, pKernels);
+  printf("%-40s %7s %12s %10s\n", "case", "frames", "ns/frame", "GB/s");
+
+  std::vector<Test::CorpusFrame> corpus;
+  int corpusKey = 0;
+  std::vector<Result> results;
+  for (const Test::Case& testCase : Test::MakeCases())
+  {
+    if (!filter.empty() && testCase.name.find(filter) == std::string::npos) continue;
+
+    int key = testCase.width << 16 | testCase.height;
+    if (key != corpusKey)
+    {
+      corpus = Test::MakeCorpus(testCase.width, testCase.height);
+      for (const char* pDump : dumps)
+      {
+        if (Test::LoadDump(pDump, testCase.width, testCase.height, corpus) < 0)
+        {
+          fprintf(stderr, "cannot read %s\n", pDump);
+          return 2;
+        }
+      }
+      corpusKey = key;
+    }
+
+    Result result = Measure(testCase, corpus, minTime);
+    printf("%-40s %7d %12.1f %10.2f\n", result.name.c_str(), result.frames, result.nsPerFrame, result.gbPerSecond);
+    fflush(stdout);
+    results.push_back(result);
+  }
+
+  if (pJson)
+  {
+    FILE* pFile = fopen(pJson, "w");
+    if (!pFile)
+    {
+      fprintf(stderr, "cannot write %s\n", pJson);
+      return 2;
+    }
+    fprintf(pFile, "{\n  \"version\": \"%s\",\n  \"kernels\": \"%s\",\n  \"results\": [\n", FRAMEUTIL_VERSION, pKernels);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+      const Result& result = results[i];
+      fprintf(pFile, "    {\"name\": \"%s\", \"frames\": %d, \"ns_per_frame\": %.1f, \"gb_per_s\": %.3f}%s\n",
+              result.name.c_str(), result.frames, result.nsPerFrame, result.gbPerSecond,
+              i + 1 < results.size() ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+  }
+
+  return 0;
+}
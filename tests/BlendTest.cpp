@@ -0,0 +1,128 @@
+// Compares FrameBlender against a plain per-pixel walk over the window and checks that flicker turns into steady
+// shades.
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameBlender.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+// What the blender has to produce, computed from the whole history of every pixel.
+std::vector<uint8_t> Reference(const std::deque<std::vector<uint8_t>>& window, int bitlen, BlendMode mode,
+                               int outBitlen)
+{
+  int size = (int)window.front().size();
+  int count = (int)window.size();
+  int mask = (1 << bitlen) - 1;
+  std::vector<uint8_t> result(size);
+  for (int i = 0; i < size; i++)
+  {
+    if (mode == BlendMode::Average)
+    {
+      int sum = 0;
+      for (const auto& frame : window) sum += frame[i] & mask;
+      int maxSum = count * mask;
+      int maxShade = (1 << outBitlen) - 1;
+      result[i] = (uint8_t)((sum * maxShade * 2 + maxSum) / (maxSum * 2));
+    }
+    else
+    {
+      for (int p = 0; p < bitlen; p++)
+      {
+        int lit = 0;
+        for (const auto& frame : window) lit += (frame[i] >> p) & 1;
+        if (lit * 2 >= count) result[i] |= (uint8_t)(1 << p);
+      }
+    }
+  }
+  return result;
+}
+
+void CompareWithReference(uint16_t width, uint16_t height, uint8_t bitlen, int window, BlendMode mode)
+{
+  FrameBlender blender(width, height, bitlen, window, mode);
+  int size = width * height;
+  uint64_t state = (uint64_t)width * 31 + height * 7 + bitlen * 3 + window;
+
+  std::deque<std::vector<uint8_t>> history;
+  std::vector<uint8_t> frame(size);
+  std::vector<uint8_t> output(size);
+  bool same = true;
+  for (int n = 0; n < 40; n++)
+  {
+    // Mostly alternating frames, with the odd random pixel. The top bits must be ignored.
+    for (int i = 0; i < size; i++)
+    {
+      uint64_t random = Test::SplitMix64(state);
+      frame[i] = (uint8_t)(random % 7 == 0 ? random >> 8 : ((n + i / 5) % 2) * (random % 2 ? 0xff : 0x01));
+    }
+    if (history.empty())
+    {
+      history.assign(blender.GetWindow(), frame);
+    }
+    else
+    {
+      history.pop_front();
+      history.push_back(frame);
+    }
+
+    blender.Process(frame.data(), output.data());
+    if (output != Reference(history, bitlen, mode, blender.GetOutputBitlen())) same = false;
+  }
+
+  char what[128];
+  snprintf(what, sizeof(what), "%s %dx%d, %d bits, window %d matches the reference",
+           mode == BlendMode::Average ? "Average" : "Majority", width, height, bitlen, window);
+  Test::Check(same, what);
+}
+
+}  // namespace
+
+int main()
+{
+  for (BlendMode mode : {BlendMode::Average, BlendMode::Majority})
+  {
+    CompareWithReference(128, 32, 2, 2, mode);
+    CompareWithReference(128, 32, 4, 3, mode);
+    CompareWithReference(128, 16, 1, 4, mode);
+    CompareWithReference(192, 64, 8, 16, mode);
+    // Sizes that leave a tail for the 16 pixel loop after the 32 pixel one, and for the scalar loop.
+    CompareWithReference(24, 2, 4, 3, mode);
+    CompareWithReference(37, 7, 2, 5, mode);
+    CompareWithReference(3, 3, 3, 1, mode);
+  }
+
+  // A pixel alternating between 0 and 3 settles on the shade in between, from the first frame on.
+  FrameBlender blender(128, 32, 2, 2);
+  Test::Check(blender.GetOutputBitlen() == 3, "two 2-bit frames need 3 bits");
+  std::vector<uint8_t> frame(128 * 32);
+  std::vector<uint8_t> planes(128 * 32 / 8 * 2);
+  std::vector<uint8_t> output(128 * 32);
+  bool steady = true;
+  for (int n = 0; n < 10; n++)
+  {
+    memset(frame.data(), n % 2 ? 3 : 0, frame.size());
+    frame[0] = 3;
+    Helper::Split(planes.data(), 128, 32, 2, frame.data());
+    blender.ProcessPlanes(planes.data(), output.data());
+    if (n > 0 && (output[1] != 4 || output.back() != 4)) steady = false;
+    if (output[0] != 7) steady = false;
+  }
+  Test::Check(steady, "flicker blends into a steady shade");
+
+  // Reset() starts over from the next frame.
+  blender.Reset();
+  memset(frame.data(), 0, frame.size());
+  blender.Process(frame.data(), output.data());
+  Test::Check(output[0] == 0 && output.back() == 0, "Reset() forgets the window");
+
+  return Test::Report();
+}
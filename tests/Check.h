@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+namespace Test
+{
+
+// Bookkeeping of the self-checking tests: every failed Check() is printed and counted, Report() prints the verdict
+// and returns the exit code for main().
+inline int& GetFailures()
+{
+  static int failures = 0;
+  return failures;
+}
+
+inline bool Check(bool condition, const char* pWhat)
+{
+  if (condition) return true;
+  printf("FAILED: %s\n", pWhat);
+  GetFailures()++;
+  return false;
+}
+
+inline int Report()
+{
+  printf("%s\n", GetFailures() == 0 ? "OK" : "FAILED");
+  return GetFailures() == 0 ? 0 : 1;
+}
+
+// Exit code of a test that can't run on this machine, registered as SKIP_RETURN_CODE of the ctest entries.
+constexpr int Skipped = 77;
+
+// Prints the kernels in use and returns false if they aren't the ones FRAMEUTIL_ISA asks for. Dispatch quietly falls
+// back to the best kernels the CPU has, so a run for a missing instruction set would otherwise test the wrong ones.
+inline bool HasRequestedKernels()
+{
+#if defined(FRAMEUTIL_USE_DISPATCH)
+  const char* pName = Dispatch::GetKernels().name;
+  const char* pRequested = getenv("FRAMEUTIL_ISA");
+  printf("kernels: %s\n", pName);
+  if (pRequested && strcmp(pRequested, pName) != 0)
+  {
+    printf("SKIPPED: FRAMEUTIL_ISA=%s is not available on this machine\n", pRequested);
+    return false;
+  }
+#endif
+  return true;
+}
+
+}  // namespace Test
+}  // namespace FrameUtil
@@ -0,0 +1,99 @@
+// Round trips frame sequences through FrameEncoder and FrameDecoder for every pixel size and a range of zone sizes,
+// including zones of more than 256 pixels where the RLE runs have to be split.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameCodec.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+// Encodes frames one after the other and checks that the decoder rebuilds every one of them exactly.
+bool RoundTrip(int width, int height, int bytesPerPixel, int zoneWidth, int zoneHeight,
+               const std::vector<std::vector<uint8_t>>& frames)
+{
+  FrameEncoder encoder((uint16_t)width, (uint16_t)height, (uint8_t)bytesPerPixel, zoneWidth, zoneHeight);
+  FrameDecoder decoder((uint16_t)width, (uint16_t)height, (uint8_t)bytesPerPixel, zoneWidth, zoneHeight);
+  std::vector<uint8_t> encoded(encoder.GetMaxEncodedSize());
+
+  for (const std::vector<uint8_t>& frame : frames)
+  {
+    size_t size = encoder.Encode(frame.data(), encoded.data(), encoded.size());
+    if (size == 0 || !decoder.Decode(encoded.data(), size)) return false;
+    if (memcmp(decoder.GetFrame(), frame.data(), frame.size()) != 0) return false;
+  }
+  return true;
+}
+
+// The corpus frames in turn, each followed by a copy with a few changed pixels and an unchanged repeat, so keyframes,
+// partial updates and empty updates all occur.
+std::vector<std::vector<uint8_t>> MakeSequence(int width, int height, int bytesPerPixel)
+{
+  std::vector<std::vector<uint8_t>> frames;
+  uint64_t state = 11;
+  for (const Test::CorpusFrame& corpusFrame : Test::MakeCorpus(width, height))
+  {
+    const uint8_t* pFrame = corpusFrame.Get(bytesPerPixel);
+    frames.emplace_back(pFrame, pFrame + (size_t)width * height * bytesPerPixel);
+
+    std::vector<uint8_t> changed = frames.back();
+    for (int i = 0; i < 5; i++)
+    {
+      changed[Test::SplitMix64(state) % changed.size()] ^= 0x5a;
+    }
+    frames.push_back(changed);
+    frames.push_back(changed);
+  }
+  return frames;
+}
+
+}  // namespace
+
+int main()
+{
+  const int zoneSizes[][2] = {{16, 8}, {32, 16}, {7, 5}, {64, 32}, {256, 64}};
+
+  for (const auto& size : Test::Sizes)
+  {
+    for (int bytesPerPixel = 1; bytesPerPixel <= 3; bytesPerPixel++)
+    {
+      std::vector<std::vector<uint8_t>> frames = MakeSequence(size[0], size[1], bytesPerPixel);
+      for (const auto& zone : zoneSizes)
+      {
+        char what[96];
+        snprintf(what, sizeof(what), "%dx%d, %d bytes per pixel, %dx%d zones", size[0], size[1], bytesPerPixel,
+                 zone[0], zone[1]);
+        Test::Check(RoundTrip(size[0], size[1], bytesPerPixel, zone[0], zone[1], frames), what);
+      }
+    }
+  }
+
+  // A run that crosses pixel 256 of a zone without being 256 pixels long is still a single RLE run.
+  std::vector<uint8_t> bands(64 * 16);
+  for (int y = 0; y < 16; y++)
+  {
+    memset(&bands[y * 64], y >= 3 && y < 10 ? 0 : 1, 64);
+  }
+  Test::Check(RoundTrip(64, 16, 1, 32, 16, {bands, std::vector<uint8_t>(64 * 16, 1), bands}),
+              "runs across pixel 256 of a zone");
+
+  // Without room the encoder gives up and sends the next frame as keyframe.
+  FrameEncoder encoder(128, 32, 1);
+  FrameDecoder decoder(128, 32, 1);
+  std::vector<uint8_t> encoded(encoder.GetMaxEncodedSize());
+  std::vector<uint8_t> frame = MakeSequence(128, 32, 1)[9];
+  Test::Check(encoder.Encode(frame.data(), encoded.data(), 4) == 0, "too small a buffer");
+  size_t size = encoder.Encode(frame.data(), encoded.data(), encoded.size());
+  Test::Check(size > 0 && (encoded[0] & FrameCodec::Keyframe) != 0, "keyframe after a failed encode");
+  Test::Check(!decoder.Decode(encoded.data(), size - 1), "truncated frame rejected");
+  Test::Check(decoder.Decode(encoded.data(), size) && memcmp(decoder.GetFrame(), frame.data(), frame.size()) == 0,
+              "keyframe decoded");
+
+  return Test::Report();
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "FrameDump.h"
+#include "FrameUtil.h"
+
+namespace FrameUtil
+{
+namespace Test
+{
+
+// A source frame in the three pixel formats the kernels take: indexed (one byte per pixel), RGB565 and RGB24.
+struct CorpusFrame
+{
+  std::string name;
+  int width;
+  int height;
+  std::vector<uint8_t> pixels[3];
+
+  const uint8_t* Get(int bytesPerPixel) const { return pixels[bytesPerPixel - 1].data(); }
+};
+
+// One kernel call at one size and format. Run() reads a frame of the corpus and writes outputSize bytes.
+struct Case
+{
+  std::string name;
+  int width;
+  int height;
+  int bytesPerPixel;
+  size_t inputSize;
+  size_t outputSize;
+  std::function<void(uint8_t* pOutput, const uint8_t* pInput)> run;
+};
+
+static const int Sizes[][2] = {{128, 32}, {192, 64}, {256, 64}};
+
+// Deterministic on every platform, unlike the distributions of <random>.
+inline uint64_t SplitMix64(uint64_t& state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t Fnv1a(const uint8_t* pData, size_t size, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ pData[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Maps a 4-bit DMD intensity to the three formats, tinted like the usual orange plasma color.
+inline CorpusFrame MakeFrame(const std::string& name, int width, int height, const std::vector<uint8_t>& levels)
+{
+  CorpusFrame frame{name, width, height, {}};
+  frame.pixels[0] = levels;
+  frame.pixels[1].resize(levels.size() * 2);
+  frame.pixels[2].resize(levels.size() * 3);
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    int level = levels[i] & 0x0f;
+    uint8_t r = (uint8_t)(level * 17);
+    uint8_t g = (uint8_t)(level * 17 * 88 / 255);
+    uint8_t b = (uint8_t)(level * 2);
+    uint16_t rgb565 = (uint16_t)((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+    frame.pixels[1][i * 2] = (uint8_t)rgb565;
+    frame.pixels[1][i * 2 + 1] = (uint8_t)(rgb565 >> 8);
+    frame.pixels[2][i * 3] = r;
+    frame.pixels[2][i * 3 + 1] = g;
+    frame.pixels[2][i * 3 + 2] = b;
+  }
+  return frame;
+}
+
+// Synthetic frames covering the cases the kernels special-case: blank, flat runs, every neighbour differing,
+// sparse content on black like most game scenes, and noise. The noise frames use the full byte range in every
+// format so that no bit of a pixel goes untested.
+inline std::vector<CorpusFrame> MakeCorpus(int width, int height)
+{
+  std::vector<CorpusFrame> corpus;
+  size_t pixelCount = (size_t)width * height;
+  std::vector<uint8_t> levels(pixelCount);
+  uint64_t state = (uint64_t)width << 16 | height;
+
+  corpus.push_back(MakeFrame("blank", width, height, levels));
+
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < width; x++) levels[y * width + x] = (uint8_t)(x * 16 / width);
+  }
+  corpus.push_back(MakeFrame("gradient", width, height, levels));
+
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < width; x++) levels[y * width + x] = ((x ^ y) & 1) ? 15 : 0;
+  }
+  corpus.push_back(MakeFrame("checker", width, height, levels));
+
+  // Blocky glyphs of 2x2 dots with anti-aliased edges, the typical look of a score or text scene.
+  std::fill(levels.begin(), levels.end(), 0);
+  for (int glyph = 0; glyph < width / 8; glyph++)
+  {
+    uint64_t shape = SplitMix64(state);
+    int top = height / 2 - 7;
+    for (int bit = 0; bit < 35; bit++)
+    {
+      if (!((shape >> bit) & 1)) continue;
+      int x = glyph * 8 + (bit % 5) * 2 - 1;
+      int y = top + (bit / 5) * 2;
+      for (int dy = 0; dy < 2; dy++)
+      {
+        for (int dx = 0; dx < 2; dx++)
+        {
+          if (x + dx >= 0 && x + dx < width) levels[(y + dy) * width + x + dx] = (uint8_t)(dx == 0 ? 15 : 9);
+        }
+      }
+    }
+  }
+  corpus.push_back(MakeFrame("text", width, height, levels));
+
+  // Few distinct values, so pixels often but not always match their neighbours.
+  for (size_t i = 0; i < pixelCount; i++) levels[i] = (uint8_t)(SplitMix64(state) % 3);
+  corpus.push_back(MakeFrame("sparse", width, height, levels));
+
+  CorpusFrame noise{"noise", width, height, {}};
+  for (int format = 0; format < 3; format++)
+  {
+    noise.pixels[format].resize(pixelCount * (format + 1));
+    for (uint8_t& byte : noise.pixels[format]) byte = (uint8_t)SplitMix64(state);
+  }
+  corpus.push_back(noise);
+
+  return corpus;
+}
+
+// Appends the recorded frames of an indexed binary dump or a DMDExt text dump, skipping frames of a different size.
+// Returns the number of frames added or -1 if the file can't be read.
+inline int LoadDump(const char* pPath, int width, int height, std::vector<CorpusFrame>& corpus)
+{
+  int loaded = 0;
+  auto add = [&](const uint8_t* pFrame, int frameWidth, int frameHeight)
+  {
+    if (frameWidth != width || frameHeight != height) return;
+    std::vector<uint8_t> levels(pFrame, pFrame + width * height);
+    corpus.push_back(MakeFrame("dump" + std::to_string(loaded++), width, height, levels));
+  };
+
+  FrameDumpReader reader;
+  if (reader.Open(pPath))
+  {
+    if (reader.GetInfo().format != PixelFormat::Indexed) return 0;
+    for (size_t i = 0; i < reader.GetFrameCount(); i++)
+    {
+      add(reader.GetFrame(i), reader.GetInfo().width, reader.GetInfo().height);
+    }
+    return loaded;
+  }
+
+  auto addText = [&](const uint8_t* pFrame, int frameWidth, int frameHeight, uint64_t)
+  {
+    add(pFrame, frameWidth, frameHeight);
+    return true;
+  };
+  return ReadDmdExtDump(pPath, addText) ? loaded : -1;
+}
+
+// 256 distinct colors, the noise frames use every index.
+inline uint8_t* GetPalette()
+{
+  static uint8_t palette[256 * 3];
+  static bool initialized = false;
+  if (!initialized)
+  {
+    for (int i = 0; i < 256 * 3; i++) palette[i] = (uint8_t)(i * 7);
+    initialized = true;
+  }
+  return palette;
+}
+
+// Every Helper kernel at every standard size, in the formats it supports.
+inline std::vector<Case> MakeCases()
+{
+  std::vector<Case> cases;
+
+  for (const auto& size : Sizes)
+  {
+    const int w = size[0];
+    const int h = size[1];
+    const size_t pixels = (size_t)w * h;
+    const std::string dims = std::to_string(w) + "x" + std::to_string(h);
+
+    for (int bitlen : {1, 2, 3, 4, 6, 8})
+    {
+      cases.push_back({"Split/" + dims + "/" + std::to_string(bitlen) + "bit", w, h, 1, pixels, pixels / 8 * bitlen,
+                       [=](uint8_t* pOutput, const uint8_t* pInput)
+                       { Helper::Split(pOutput, w, h, bitlen, const_cast<uint8_t*>(pInput)); }});
+      cases.push_back({"Join/" + dims + "/" + std::to_string(bitlen) + "bit", w, h, 1, pixels / 8 * bitlen, pixels,
+                       [=](uint8_t* pOutput, const uint8_t* pInput) { Helper::Join(pOutput, w, h, bitlen, pInput); }});
+    }
+
+    for (ColorMatrix matrix : {ColorMatrix::Rgb, ColorMatrix::Rbg})
+    {
+      const char* pMatrix = matrix == ColorMatrix::Rgb ? "rgb" : "rbg";
+      cases.push_back({"SplitIntoRgbPlanes/" + dims + "/16bit-" + pMatrix, w, h, 2, pixels * 2, pixels * 3 / 2,
+                       [=](uint8_t* pOutput, const uint8_t* pInput)
+                       {
+                         Helper::SplitIntoRgbPlanes((const uint16_t*)pInput, (int)pixels, w, 16, pOutput, matrix);
+                       }});
+    }
+
+    cases.push_back({"ConvertToRgb24/" + dims + "/8bit", w, h, 1, pixels, pixels * 3,
+                     [=](uint8_t* pOutput, const uint8_t* pInput)
+                     {
+                       Helper::ConvertToRgb24(pOutput, const_cast<uint8_t*>(pInput), (int)pixels, GetPalette());
+                     }});
+
+    for (int bytes = 1; bytes <= 3; bytes++)
+    {
+      const std::string format = "/" + std::to_string(bytes * 8) + "bit";
+      const uint8_t bits = (uint8_t)(bytes * 8);
+      cases.push_back({"ScaleUp/" + dims + format, w, h, bytes, pixels * bytes, pixels * 4 * bytes,
+                       [=](uint8_t* pOutput, const uint8_t* pInput) { Helper::ScaleUp(pOutput, pInput, w, h, bits); }});
+      cases.push_back({"ScaleDown/" + dims + format, w, h, bytes, pixels * bytes, pixels / 4 * bytes,
+                       [=](uint8_t* pOutput, const uint8_t* pInput)
+                       { Helper::ScaleDown(pOutput, w / 2, h / 2, pInput, w, h, bits); }});
+      // Places the top left quarter of the input in the middle of a full size frame.
+      cases.push_back({"Center/" + dims + format, w, h, bytes, pixels / 4 * bytes, pixels * bytes,
+                       [=](uint8_t* pOutput, const uint8_t* pInput)
+                       { Helper::Center(pOutput, w, h, pInput, w / 2, h / 2, bits); }});
+    }
+
+    cases.push_back({"ScaleDownIndexed/" + dims + "/8bit", w, h, 1, pixels, pixels / 4,
+                     [=](uint8_t* pOutput, const uint8_t* pInput)
+                     { Helper::ScaleDownIndexed(pOutput, w / 2, h / 2, pInput, w, h); }});
+    cases.push_back({"ScaleDownPUP/" + dims + "/8bit", w, h, 1, pixels, pixels / 4,
+                     [=](uint8_t* pOutput, const uint8_t* pInput)
+                     { Helper::ScaleDownPUP(pOutput, w / 2, h / 2, pInput, w, h); }});
+  }
+
+  return cases;
+}
+
+}  // namespace Test
+}  // namespace FrameUtil
@@ -0,0 +1,154 @@
+// Checks FrameDiff against a plain pixel by pixel comparison: changed rows, changed zones, their counts and the
+// bounding box, for every pixel size and zone sizes that do and don't divide the frame.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameDiff.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+// Compares diff with what a brute-force comparison of previous and frame finds.
+bool Matches(const FrameDiff& diff, bool changed, const std::vector<uint8_t>& previous,
+             const std::vector<uint8_t>& frame, int width, int height, int bytesPerPixel, int zoneWidth,
+             int zoneHeight)
+{
+  int zoneColumns = (width + zoneWidth - 1) / zoneWidth;
+  int zoneRows = (height + zoneHeight - 1) / zoneHeight;
+  std::vector<bool> rows(height, false);
+  std::vector<bool> zones(zoneColumns * zoneRows, false);
+  int minX = width, maxX = -1, minY = height, maxY = -1;
+
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < width; x++)
+    {
+      size_t offset = ((size_t)y * width + x) * bytesPerPixel;
+      if (memcmp(&previous[offset], &frame[offset], bytesPerPixel) == 0) continue;
+      rows[y] = true;
+      zones[(y / zoneHeight) * zoneColumns + x / zoneWidth] = true;
+      if (x < minX) minX = x;
+      if (x > maxX) maxX = x;
+      if (y < minY) minY = y;
+      if (y > maxY) maxY = y;
+    }
+  }
+
+  if (diff.GetZoneColumns() != zoneColumns || diff.GetZoneRows() != zoneRows) return false;
+  int rowCount = 0;
+  for (int y = 0; y < height; y++)
+  {
+    if (diff.IsRowChanged(y) != rows[y]) return false;
+    rowCount += rows[y];
+  }
+  int zoneCount = 0;
+  for (int zoneY = 0; zoneY < zoneRows; zoneY++)
+  {
+    for (int zoneX = 0; zoneX < zoneColumns; zoneX++)
+    {
+      if (diff.IsZoneChanged(zoneX, zoneY) != zones[zoneY * zoneColumns + zoneX]) return false;
+      zoneCount += zones[zoneY * zoneColumns + zoneX];
+    }
+  }
+  if (diff.GetChangedRowCount() != rowCount || diff.GetChangedZoneCount() != zoneCount) return false;
+  if (changed != (rowCount > 0)) return false;
+
+  int x, y, w, h;
+  if (!diff.GetBoundingBox(x, y, w, h)) return maxX < 0;
+  return x == minX && y == minY && w == maxX - minX + 1 && h == maxY - minY + 1;
+}
+
+// What the first frame after construction or Reset() has to report.
+bool AllChanged(const FrameDiff& diff, bool changed, int width, int height)
+{
+  int x, y, w, h;
+  return changed && diff.GetChangedRowCount() == height &&
+         diff.GetChangedZoneCount() == diff.GetZoneColumns() * diff.GetZoneRows() && diff.IsRowChanged(height - 1) &&
+         diff.IsZoneChanged(diff.GetZoneColumns() - 1, diff.GetZoneRows() - 1) && diff.GetBoundingBox(x, y, w, h) &&
+         x == 0 && y == 0 && w == width && h == height;
+}
+
+// Runs a sequence of frames with single changed bytes, changed blocks and repeats through a FrameDiff.
+bool Run(int width, int height, int bytesPerPixel, int zoneWidth, int zoneHeight, const uint8_t* pFirst)
+{
+  FrameDiff diff((uint16_t)width, (uint16_t)height, (uint8_t)bytesPerPixel, zoneWidth, zoneHeight, true);
+  size_t size = (size_t)width * height * bytesPerPixel;
+  std::vector<uint8_t> frame(pFirst, pFirst + size);
+
+  // The first frame counts as fully changed.
+  if (!AllChanged(diff, diff.Update(frame.data()), width, height)) return false;
+
+  uint64_t state = 13;
+  for (int step = 0; step < 64; step++)
+  {
+    std::vector<uint8_t> previous = frame;
+    switch (step % 4)
+    {
+      case 0:
+        // Nothing changed.
+        break;
+      case 1:
+        // A few single bytes anywhere, in any channel.
+        for (int i = 0; i < 3; i++) frame[Test::SplitMix64(state) % size] ^= 0x21;
+        break;
+      case 2:
+      {
+        // A block, possibly reaching the right or bottom edge.
+        int x0 = (int)(Test::SplitMix64(state) % width);
+        int y0 = (int)(Test::SplitMix64(state) % height);
+        int x1 = x0 + 1 + (int)(Test::SplitMix64(state) % 24);
+        int y1 = y0 + 1 + (int)(Test::SplitMix64(state) % 12);
+        for (int y = y0; y < y1 && y < height; y++)
+        {
+          for (int x = x0; x < x1 && x < width; x++) frame[((size_t)y * width + x) * bytesPerPixel] += 1;
+        }
+        break;
+      }
+      case 3:
+        // The last byte of the frame only.
+        frame[size - 1] ^= 0x80;
+        break;
+    }
+    bool changed = diff.Update(frame.data());
+    if (!Matches(diff, changed, previous, frame, width, height, bytesPerPixel, zoneWidth, zoneHeight)) return false;
+  }
+
+  // After Reset() everything counts as changed again.
+  diff.Reset();
+  return AllChanged(diff, diff.Update(frame.data()), width, height);
+}
+
+}  // namespace
+
+int main()
+{
+  const int zoneSizes[][2] = {{16, 8}, {32, 16}, {7, 5}, {64, 64}};
+
+  for (const auto& size : Test::Sizes)
+  {
+    std::vector<Test::CorpusFrame> corpus = Test::MakeCorpus(size[0], size[1]);
+    for (int bytesPerPixel = 1; bytesPerPixel <= 3; bytesPerPixel++)
+    {
+      for (const auto& zone : zoneSizes)
+      {
+        char what[96];
+        snprintf(what, sizeof(what), "%dx%d, %d bytes per pixel, %dx%d zones", size[0], size[1], bytesPerPixel,
+                 zone[0], zone[1]);
+        Test::Check(Run(size[0], size[1], bytesPerPixel, zone[0], zone[1], corpus.back().Get(bytesPerPixel)), what);
+      }
+    }
+  }
+
+  // A width that isn't a multiple of any SIMD width, with partial zones at the right and bottom.
+  std::vector<uint8_t> odd(99 * 37 * 3, 0x40);
+  Test::Check(Run(99, 37, 3, 16, 8, odd.data()), "99x37, 3 bytes per pixel, 16x8 zones");
+  Test::Check(Run(99, 37, 1, 7, 5, odd.data()), "99x37, 1 byte per pixel, 7x5 zones");
+
+  return Test::Report();
+}
@@ -0,0 +1,108 @@
+// Round trips frames through the binary dump format and the DMDExt text importer.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameDump.h"
+
+using namespace FrameUtil;
+
+int main()
+{
+  const char* pDumpPath = "frameutil_dump_test.fdmp";
+  const char* pTextPath = "frameutil_dump_test.txt";
+
+  FrameDumpInfo info;
+  info.width = 192;
+  info.height = 64;
+  info.format = PixelFormat::Rgb565;
+  info.palette = {0, 0, 0, 255, 88, 32};
+
+  std::vector<Test::CorpusFrame> corpus = Test::MakeCorpus(info.width, info.height);
+  {
+    FrameDumpWriter writer;
+    Test::Check(writer.Open(pDumpPath, info), "create");
+    for (size_t i = 0; i < 4; i++)
+    {
+      Test::Check(writer.Write(corpus[i].Get(2), i * 16000), "write");
+    }
+    Test::Check(!writer.Write(corpus[0].Get(2), 1000), "decreasing timestamp rejected");
+  }
+
+  // Simulate a crash in the middle of a record, appending has to continue after the last complete one.
+  FILE* pFile = fopen(pDumpPath, "ab");
+  fwrite(corpus[5].Get(2), 1, 100, pFile);
+  fclose(pFile);
+  {
+    FrameDumpWriter writer;
+    FrameDumpInfo other = info;
+    other.format = PixelFormat::Rgb24;
+    Test::Check(!writer.Open(pDumpPath, other, true), "append with other format rejected");
+    Test::Check(writer.Open(pDumpPath, info, true), "append");
+    Test::Check(writer.GetFrameCount() == 4, "frames found for append");
+    Test::Check(!writer.Write(corpus[4].Get(2), 1000), "timestamp before existing frames rejected");
+    Test::Check(writer.Write(corpus[4].Get(2), 64000), "append 4");
+    Test::Check(writer.Write(corpus[5].Get(2), 64000), "append 5");
+  }
+
+  {
+    FrameDumpReader reader;
+    Test::Check(reader.Open(pDumpPath), "open");
+    Test::Check(reader.GetInfo().width == info.width && reader.GetInfo().height == info.height &&
+                    reader.GetInfo().format == info.format && reader.GetInfo().palette == info.palette,
+                "header");
+    Test::Check(reader.GetFrameCount() == 6, "frame count");
+    for (size_t i = 0; i < reader.GetFrameCount() && i < 6; i++)
+    {
+      Test::Check(memcmp(reader.GetFrame(i), corpus[i].Get(2), info.GetFrameSize()) == 0, "frame content");
+      Test::Check(reader.GetTimestamp(i) == (i < 5 ? i * 16000 : 64000), "timestamp");
+    }
+    Test::Check(reader.FindFrame(0) == 0 && reader.FindFrame(15999) == 0 && reader.FindFrame(16000) == 1 &&
+                    reader.FindFrame(64000) == 5 && reader.FindFrame(1000000) == 5,
+                "find frame");
+
+    // Views are copy on write.
+    FrameView view = reader.GetView(1);
+    Test::Check(view.GetWidth() == info.width && view.GetFormat() == PixelFormat::Rgb565, "view");
+    view.Clear();
+    FrameDumpReader other;
+    Test::Check(other.Open(pDumpPath) && memcmp(other.GetFrame(1), corpus[1].Get(2), info.GetFrameSize()) == 0,
+                "file unchanged by view");
+  }
+
+  // Two frames of a DMDExt dump, the second using 4-bit values.
+  pFile = fopen(pTextPath, "w");
+  const int width = 16;
+  const int height = 4;
+  for (int frame = 0; frame < 2; frame++)
+  {
+    fprintf(pFile, "0x%08x\n", 1000 + frame * 40);
+    for (int y = 0; y < height; y++)
+    {
+      for (int x = 0; x < width; x++) fputc("0123456789abcdef"[(x + y + frame * 5) % (frame ? 16 : 4)], pFile);
+      fputc('\n', pFile);
+    }
+    fputc('\n', pFile);
+  }
+  fclose(pFile);
+
+  Test::Check(ImportDmdExtDump(pTextPath, pDumpPath) == 2, "import");
+  {
+    FrameDumpReader reader;
+    Test::Check(reader.Open(pDumpPath), "open import");
+    Test::Check(reader.GetInfo().width == width && reader.GetInfo().height == height && reader.GetInfo().bitlen == 4,
+                "import header");
+    Test::Check(reader.GetFrameCount() == 2 && reader.GetTimestamp(1) == 1040000, "import timestamps");
+    Test::Check(reader.GetFrameCount() == 2 && reader.GetFrame(1)[1] == 6 && reader.GetFrame(0)[5] == 1,
+                "import pixels");
+  }
+
+  Test::Check(!FrameDumpReader().Open(pTextPath), "text is no binary dump");
+  remove(pDumpPath);
+  remove(pTextPath);
+
+  return Test::Report();
+}
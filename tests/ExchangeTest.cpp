@@ -0,0 +1,135 @@
+// Hammers FrameExchange with one and with several producers. Every frame is filled with a pattern derived from its
+// producer and number, so the consumer can tell a torn or stale frame from an intact one.
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+#include "FrameExchange.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+// The first 8 bytes hold producer and number, every other byte repeats their sum.
+void Fill(uint8_t* pFrame, size_t size, uint32_t producer, uint32_t number)
+{
+  memcpy(pFrame, &producer, 4);
+  memcpy(pFrame + 4, &number, 4);
+  memset(pFrame + 8, (int)(uint8_t)(producer + number), size - 8);
+}
+
+bool IsIntact(const uint8_t* pFrame, size_t size, uint32_t& producer, uint32_t& number)
+{
+  memcpy(&producer, pFrame, 4);
+  memcpy(&number, pFrame + 4, 4);
+  uint8_t expected = (uint8_t)(producer + number);
+  for (size_t i = 8; i < size; i++)
+  {
+    if (pFrame[i] != expected) return false;
+  }
+  return true;
+}
+
+void Run(int numProducers, uint32_t framesPerProducer)
+{
+  FrameExchange exchange(128, 32, PixelFormat::Rgb24, numProducers);
+  size_t size = exchange.GetFrameSize();
+  Test::Check(exchange.Acquire() == nullptr && exchange.GetFrame() == nullptr, "nothing to acquire before Publish()");
+
+  std::atomic<int> running{numProducers};
+  std::vector<std::thread> producers;
+  for (int p = 0; p < numProducers; p++)
+  {
+    producers.emplace_back(
+        [&, p]()
+        {
+          for (uint32_t number = 1; number <= framesPerProducer; number++)
+          {
+            Fill(exchange.GetWriteBuffer(p), size, (uint32_t)p, number);
+            exchange.Publish(p);
+          }
+          running.fetch_sub(1);
+        });
+  }
+
+  std::vector<uint32_t> lastNumber(numProducers, 0);
+  uint64_t lastFrameNumber = 0;
+  bool intact = true;
+  bool ordered = true;
+  for (;;)
+  {
+    // Read the flag first, a frame published after it is still picked up by the Acquire() below.
+    bool done = running.load() == 0;
+    const uint8_t* pFrame = exchange.Acquire();
+    if (pFrame)
+    {
+      uint32_t producer;
+      uint32_t number;
+      if (!IsIntact(pFrame, size, producer, number) || producer >= (uint32_t)numProducers)
+      {
+        intact = false;
+      }
+      else
+      {
+        if (number <= lastNumber[producer]) ordered = false;
+        lastNumber[producer] = number;
+      }
+      if (exchange.GetFrameNumber() <= lastFrameNumber) ordered = false;
+      lastFrameNumber = exchange.GetFrameNumber();
+    }
+    else if (done)
+    {
+      break;
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  for (std::thread& thread : producers)
+  {
+    thread.join();
+  }
+
+  FrameExchange::Stats stats = exchange.GetStats();
+  printf("%d producers: %llu published, %llu acquired, %llu dropped\n", numProducers,
+         (unsigned long long)stats.published, (unsigned long long)stats.acquired, (unsigned long long)stats.dropped);
+
+  Test::Check(intact, "frames arrive intact");
+  Test::Check(ordered, "frames arrive in order");
+  Test::Check(stats.published == (uint64_t)numProducers * framesPerProducer, "published count");
+  Test::Check(stats.published == stats.acquired + stats.dropped, "every frame is acquired or dropped");
+  Test::Check(lastFrameNumber == stats.published, "the last frame wins");
+  if (numProducers == 1) Test::Check(lastNumber[0] == framesPerProducer, "the last frame of the producer is shown");
+}
+
+}  // namespace
+
+int main()
+{
+  Run(1, 200000);
+  Run(3, 50000);
+
+  // Publishing twice without an Acquire() in between drops the older frame.
+  FrameExchange exchange(16);
+  Fill(exchange.GetWriteBuffer(), 16, 0, 1);
+  exchange.Publish();
+  Fill(exchange.GetWriteBuffer(), 16, 0, 2);
+  exchange.Publish();
+  uint32_t producer;
+  uint32_t number;
+  const uint8_t* pFrame = exchange.Acquire();
+  Test::Check(pFrame && IsIntact(pFrame, 16, producer, number) && number == 2, "the newer frame wins");
+  Test::Check(exchange.GetFrameNumber() == 2, "frame number of the newer frame");
+  Test::Check(exchange.Acquire() == nullptr && exchange.GetFrame() == pFrame,
+              "the shown frame stays until the next one");
+  FrameExchange::Stats stats = exchange.GetStats();
+  Test::Check(stats.published == 2 && stats.dropped == 1 && stats.acquired == 1, "drop statistics");
+
+  return Test::Report();
+}
@@ -0,0 +1,127 @@
+// Pins the output of every Helper kernel byte for byte. Each case runs over the whole synthetic corpus and its outputs
+// are hashed into one value, which has to match the recorded one in golden.txt. The recorded values come from the
+// scalar kernels, every SIMD build has to reproduce them exactly.
+//
+//   frameutil_golden <golden.txt>           compare, exit code 1 on any mismatch
+//   frameutil_golden --update <golden.txt>  record the current output, run with FRAMEUTIL_ISA=scalar
+//
+// Exits with 77 (skipped) if FRAMEUTIL_ISA asks for kernels the CPU can't run.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+uint64_t RunCase(const Test::Case& testCase, const std::vector<Test::CorpusFrame>& corpus)
+{
+  uint64_t hash = Test::Fnv1a(nullptr, 0);
+  std::vector<uint8_t> input(testCase.inputSize);
+  std::vector<uint8_t> output(testCase.outputSize);
+
+  for (const Test::CorpusFrame& frame : corpus)
+  {
+    // Join reads planes instead of pixels, any bytes will do.
+    memcpy(input.data(), frame.Get(testCase.bytesPerPixel), testCase.inputSize);
+    // Bytes a kernel leaves alone are part of its behaviour as well.
+    memset(output.data(), 0xcd, output.size());
+    testCase.run(output.data(), input.data());
+    hash = Test::Fnv1a(output.data(), output.size(), hash);
+  }
+  return hash;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  bool update = argc == 3 && strcmp(argv[1], "--update") == 0;
+  if (argc != 2 && !update)
+  {
+    fprintf(stderr, "usage: %s [--update] <golden.txt>\n", argv[0]);
+    return 2;
+  }
+  const char* pPath = argv[argc - 1];
+
+  if (!Test::HasRequestedKernels()) return Test::Skipped;
+
+  std::map<std::string, uint64_t> golden;
+  if (!update)
+  {
+    FILE* pFile = fopen(pPath, "r");
+    if (!pFile)
+    {
+      fprintf(stderr, "cannot read %s\n", pPath);
+      return 2;
+    }
+    char name[128];
+    uint64_t hash;
+    while (fscanf(pFile, "%127s %" SCNx64, name, &hash) == 2) golden[name] = hash;
+    fclose(pFile);
+  }
+
+  std::map<int, std::vector<Test::CorpusFrame>> corpora;
+  std::vector<std::pair<std::string, uint64_t>> results;
+  for (const Test::Case& testCase : Test::MakeCases())
+  {
+    int key = testCase.width << 16 | testCase.height;
+    if (corpora.find(key) == corpora.end()) corpora[key] = Test::MakeCorpus(testCase.width, testCase.height);
+    results.emplace_back(testCase.name, RunCase(testCase, corpora[key]));
+  }
+
+  if (update)
+  {
+    FILE* pFile = fopen(pPath, "w");
+    if (!pFile)
+    {
+      fprintf(stderr, "cannot write %s\n", pPath);
+      return 2;
+    }
+    for (const auto& result : results) fprintf(pFile, "%s %016" PRIx64 "\n", result.first.c_str(), result.second);
+    fclose(pFile);
+    printf("recorded %d cases\n", (int)results.size());
+    return 0;
+  }
+
+  int failures = 0;
+#if defined(FRAMEUTIL_USE_STATS)
+  // Every case went through an instrumented entry point, the forwarding ones must not count twice.
+  uint64_t calls = 0;
+  for (const Stats::Counter& counter : Stats::GetSnapshot())
+  {
+    printf("%-32s %8" PRIu64 " calls %10" PRIu64 " ns avg %10" PRIu64 " ns p99\n", counter.name.c_str(), counter.calls,
+           counter.GetAverageNs(), counter.GetPercentileNs(0.99));
+    calls += counter.calls;
+  }
+  if (calls != results.size() * corpora.begin()->second.size())
+  {
+    printf("STATS    %" PRIu64 " calls recorded\n", calls);
+    failures++;
+  }
+#endif
+  for (const auto& result : results)
+  {
+    auto it = golden.find(result.first);
+    if (it == golden.end())
+    {
+      printf("MISSING  %s\n", result.first.c_str());
+      failures++;
+    }
+    else if (it->second != result.second)
+    {
+      printf("MISMATCH %s: %016" PRIx64 " expected %016" PRIx64 "\n", result.first.c_str(), result.second, it->second);
+      failures++;
+    }
+  }
+  printf("%d of %d cases passed\n", (int)results.size() - failures, (int)results.size());
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// Checks that FrameCache hits, misses and evicts like a plain LRU list, and that FrameHash gives the same fingerprint
+// for every split of the data.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameHash.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+const size_t FrameSize = 48;
+
+// Every hash gets its own frame content, so a hit returning the wrong entry shows up.
+std::vector<uint8_t> MakeFrame(uint64_t hash)
+{
+  std::vector<uint8_t> frame(FrameSize);
+  uint64_t state = hash;
+  for (uint8_t& value : frame) value = (uint8_t)Test::SplitMix64(state);
+  return frame;
+}
+
+bool IsFrame(const uint8_t* pFrame, uint64_t hash)
+{
+  return pFrame && memcmp(pFrame, MakeFrame(hash).data(), FrameSize) == 0;
+}
+
+void CheckEvictionOrder()
+{
+  FrameCache cache(3, FrameSize);
+  Test::Check(cache.GetNumEntries() == 3 && cache.GetFrameSize() == FrameSize, "size of the cache");
+  Test::Check(cache.Find(1) == nullptr, "an empty cache misses");
+
+  for (uint64_t hash : {1, 2, 3}) cache.Insert(hash, MakeFrame(hash).data());
+  Test::Check(IsFrame(cache.Find(1), 1) && IsFrame(cache.Find(2), 2) && IsFrame(cache.Find(3), 3), "all entries hit");
+
+  // The hit on 1 makes 2 the least recently used entry.
+  cache.Find(1);
+  cache.Insert(4, MakeFrame(4).data());
+  Test::Check(cache.Find(2) == nullptr, "the least recently used entry is evicted");
+  Test::Check(IsFrame(cache.Find(1), 1) && IsFrame(cache.Find(3), 3) && IsFrame(cache.Find(4), 4),
+              "the other entries stay");
+
+  // Inserting a cached hash again replaces its frame instead of taking a second entry.
+  std::vector<uint8_t> replacement = MakeFrame(99);
+  cache.Insert(3, replacement.data());
+  Test::Check(IsFrame(cache.Find(3), 99), "inserting a cached hash replaces its frame");
+  Test::Check(IsFrame(cache.Find(1), 1) && IsFrame(cache.Find(4), 4), "reinserting doesn't evict");
+
+  cache.Clear();
+  Test::Check(cache.Find(1) == nullptr && cache.Find(3) == nullptr && cache.Find(4) == nullptr,
+              "Clear() empties the cache");
+  cache.Insert(5, MakeFrame(5).data());
+  Test::Check(IsFrame(cache.Find(5), 5), "the cache works after Clear()");
+
+  FrameCache none(0, FrameSize);
+  none.Insert(1, MakeFrame(1).data());
+  Test::Check(none.Find(1) == nullptr, "a cache without entries never hits");
+}
+
+// Random lookups and inserts over a few more hashes than entries, compared with a list ordered by last use.
+void CheckAgainstList()
+{
+  const int numEntries = 5;
+  FrameCache cache(numEntries, FrameSize);
+  std::list<uint64_t> lru;
+  uint64_t state = 17;
+  bool same = true;
+
+  for (int step = 0; step < 20000; step++)
+  {
+    uint64_t hash = Test::SplitMix64(state) % 8;
+    auto entry = std::find(lru.begin(), lru.end(), hash);
+    const uint8_t* pFrame = cache.Find(hash);
+    if ((pFrame != nullptr) != (entry != lru.end()) || (pFrame && !IsFrame(pFrame, hash))) same = false;
+
+    if (entry != lru.end())
+    {
+      lru.erase(entry);
+    }
+    else
+    {
+      cache.Insert(hash, MakeFrame(hash).data());
+      if ((int)lru.size() == numEntries) lru.pop_back();
+    }
+    lru.push_front(hash);
+  }
+  Test::Check(same, "hits and misses follow the LRU order");
+}
+
+void CheckHashSplits()
+{
+  std::vector<uint8_t> data(1500);
+  std::vector<uint8_t> mask(data.size());
+  uint64_t state = 19;
+  for (uint8_t& value : data) value = (uint8_t)Test::SplitMix64(state);
+  for (uint8_t& value : mask) value = Test::SplitMix64(state) % 3 == 0 ? 0x00 : 0xff;
+  std::vector<uint8_t> masked(data.size());
+  for (size_t i = 0; i < data.size(); i++) masked[i] = data[i] & mask[i];
+
+  bool same = true;
+  for (size_t length : {0, 1, 31, 32, 33, 511, 512, 513, 1500})
+  {
+    uint64_t expected = FrameHash::Hash(data.data(), length, 7);
+    // Every split into two parts, and chunks of every size up to the stripe width.
+    for (size_t split = 0; split <= length; split += length > 64 ? 13 : 1)
+    {
+      FrameHash hash(7);
+      hash.Update(data.data(), split);
+      hash.Update(&data[split], length - split);
+      if (hash.Finish() != expected) same = false;
+    }
+    for (size_t chunk = 1; chunk <= 33; chunk++)
+    {
+      FrameHash hash(7);
+      for (size_t offset = 0; offset < length; offset += chunk)
+      {
+        hash.Update(&data[offset], std::min(chunk, length - offset));
+        // Finish() in between doesn't change the state.
+        hash.Finish();
+      }
+      if (hash.Finish() != expected) same = false;
+    }
+    if (FrameHash::HashMasked(data.data(), mask.data(), length, 7) != FrameHash::Hash(masked.data(), length, 7))
+      same = false;
+  }
+  Test::Check(same, "every split of the data gives the same fingerprint");
+  Test::Check(FrameHash::Hash(data.data(), 64, 1) != FrameHash::Hash(data.data(), 64, 2), "the seed counts");
+  // The last stripe is padded with zeros, only the length tells a trailing zero from the padding.
+  std::vector<uint8_t> padded(data.begin(), data.begin() + 63);
+  padded.push_back(0);
+  Test::Check(FrameHash::Hash(padded.data(), 64) != FrameHash::Hash(data.data(), 63), "trailing zeros count");
+}
+
+}  // namespace
+
+int main()
+{
+  CheckEvictionOrder();
+  CheckAgainstList();
+  CheckHashSplits();
+
+  return Test::Report();
+}
@@ -0,0 +1,107 @@
+// Checks FramePipeline configurations whose behaviour the golden test of the Helper kernels can't see.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FramePipeline.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+// Converts frame with a pipeline that never had a cache, as the reference for the cached one.
+std::vector<uint8_t> ConvertToBcm(const std::vector<uint8_t>& frame, int depth)
+{
+  FramePipeline pipeline;
+  pipeline.SetSource(PixelFormat::Indexed, 128, 32);
+  pipeline.SetPalette(Test::GetPalette(), 4);
+  pipeline.SetTarget(PlaneFormat::BcmPlanes, 128, 32);
+  pipeline.SetBcm(depth);
+  std::vector<uint8_t> output(pipeline.GetTargetSize());
+  pipeline.Process(frame.data(), output.data());
+  return output;
+}
+
+void CheckBcmDepthChange()
+{
+  std::vector<uint8_t> frame(128 * 32);
+  uint64_t state = 3;
+  for (uint8_t& pixel : frame) pixel = (uint8_t)(Test::SplitMix64(state) % 4);
+
+  FramePipeline pipeline;
+  pipeline.SetSource(PixelFormat::Indexed, 128, 32);
+  pipeline.SetPalette(Test::GetPalette(), 4);
+  pipeline.SetTarget(PlaneFormat::BcmPlanes, 128, 32);
+  pipeline.SetCacheSize(4);
+
+  // Deeper and shallower again, every output buffer exactly as large as the target, so overruns show up in ASan.
+  for (int depth : {8, 2, 6, 8})
+  {
+    pipeline.SetBcm(depth);
+    for (int pass = 0; pass < 2; pass++)
+    {
+      std::vector<uint8_t> output(pipeline.GetTargetSize());
+      pipeline.Process(frame.data(), output.data());
+      char what[64];
+      snprintf(what, sizeof(what), "BCM depth %d, %s", depth, pass == 0 ? "converted" : "from the cache");
+      Test::Check(output == ConvertToBcm(frame, depth), what);
+    }
+  }
+}
+
+// Scaling down an indexed frame gives what scaling down its colors gives, whether the pipeline works on the indices
+// or, because of duplicate palette colors, on the colors.
+void CheckScaleDown()
+{
+  std::vector<uint8_t> frame(128 * 32);
+  uint64_t state = 7;
+  // Few distinct indices, so most 2x2 blocks have a repeat and some have ties. Indices 14 and 15 stay unused.
+  for (uint8_t& pixel : frame) pixel = (uint8_t)(Test::SplitMix64(state) % 5 * 3);
+
+  uint8_t palette[16 * 3];
+  for (int i = 0; i < 16 * 3; i++) palette[i] = (uint8_t)(i * 5 + 1);
+  uint8_t duplicates[16 * 3];
+  memcpy(duplicates, palette, sizeof(palette));
+  memcpy(&duplicates[15 * 3], &duplicates[14 * 3], 3);
+
+  std::vector<uint8_t> rgb24(128 * 32 * 3);
+  Helper::ConvertToRgb24(rgb24.data(), frame.data(), (int)frame.size(), palette);
+  std::vector<uint8_t> expectedRgb24(64 * 16 * 3);
+  Helper::ScaleDown(expectedRgb24.data(), 64, 16, rgb24.data(), 128, 32, 24);
+  std::vector<uint8_t> expectedIndexed(64 * 16);
+  Helper::ScaleDown(expectedIndexed.data(), 64, 16, frame.data(), 128, 32, 8);
+
+  for (const uint8_t* pPalette : {palette, duplicates})
+  {
+    FramePipeline pipeline;
+    pipeline.SetSource(PixelFormat::Indexed, 128, 32);
+    pipeline.SetPalette(pPalette, 16);
+    pipeline.SetScaleMode(ScaleMode::ScaleDown);
+    pipeline.SetTarget(PixelFormat::Rgb24, 64, 16);
+    std::vector<uint8_t> output(pipeline.GetTargetSize());
+    pipeline.Process(frame.data(), output.data());
+    Test::Check(output == expectedRgb24, pPalette == palette ? "ScaleDown on indices" : "ScaleDown on colors");
+  }
+
+  FramePipeline pipeline;
+  pipeline.SetSource(PixelFormat::Indexed, 128, 32);
+  pipeline.SetScaleMode(ScaleMode::ScaleDown);
+  pipeline.SetTarget(PixelFormat::Indexed, 64, 16);
+  std::vector<uint8_t> output(pipeline.GetTargetSize());
+  pipeline.Process(frame.data(), output.data());
+  Test::Check(output == expectedIndexed, "ScaleDown to indices");
+}
+
+}  // namespace
+
+int main()
+{
+  CheckBcmDepthChange();
+  CheckScaleDown();
+
+  return Test::Report();
+}
@@ -0,0 +1,133 @@
+// Checks FrameQuantizer against a plain nearest color search over the whole palette for every RGB565 color, and that
+// indexed frames survive the way to RGB and back.
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameQuantizer.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+int Expand(int value, int bits) { return (value << (8 - bits)) | (value >> (2 * bits - 8)); }
+
+uint8_t Nearest(const std::vector<uint8_t>& palette, uint16_t rgb565)
+{
+  int r = Expand(rgb565 >> 11, 5);
+  int g = Expand((rgb565 >> 5) & 0x3f, 6);
+  int b = Expand(rgb565 & 0x1f, 5);
+  int best = INT_MAX;
+  int bestIndex = 0;
+  for (int i = 0; i < (int)palette.size() / 3; i++)
+  {
+    int dr = palette[i * 3] - r;
+    int dg = palette[i * 3 + 1] - g;
+    int db = palette[i * 3 + 2] - b;
+    int distance = dr * dr + dg * dg + db * db;
+    if (distance < best)
+    {
+      best = distance;
+      bestIndex = i;
+    }
+  }
+  return (uint8_t)bestIndex;
+}
+
+}  // namespace
+
+int main()
+{
+  uint64_t state = 5;
+  FrameQuantizer quantizer;
+
+  for (int numColors : {1, 4, 16, 64, 256})
+  {
+    // Random colors with a few duplicates, which have to resolve to the lower index.
+    std::vector<uint8_t> palette(numColors * 3);
+    for (uint8_t& value : palette) value = (uint8_t)Test::SplitMix64(state);
+    if (numColors >= 16) memcpy(&palette[9 * 3], &palette[3 * 3], 3);
+
+    // The first lookup builds the table.
+    auto start = std::chrono::steady_clock::now();
+    quantizer.Set(palette.data(), numColors);
+    quantizer.GetIndex(0);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("%3d colors: table built in %.2f ms\n", numColors, elapsed);
+
+    bool same = true;
+    for (int color = 0; color < 65536; color++)
+    {
+      if (quantizer.GetIndex((uint16_t)color) != Nearest(palette, (uint16_t)color)) same = false;
+    }
+
+    char what[64];
+    snprintf(what, sizeof(what), "%d colors match the nearest color search", numColors);
+    Test::Check(same, what);
+  }
+
+  // A palette of colors RGB565 can hold exactly comes back unchanged, from every RGB format.
+  const int width = 128;
+  const int height = 32;
+  std::vector<uint8_t> palette(64 * 3);
+  for (int i = 0; i < 64; i++)
+  {
+    palette[i * 3] = (uint8_t)Expand((i * 7) & 0x1f, 5);
+    palette[i * 3 + 1] = (uint8_t)Expand(i, 6);
+    palette[i * 3 + 2] = (uint8_t)Expand((i * 13 + 5) & 0x1f, 5);
+  }
+  std::vector<uint8_t> frame(width * height);
+  for (uint8_t& pixel : frame) pixel = (uint8_t)(Test::SplitMix64(state) % 64);
+
+  quantizer.Set(palette.data(), 64);
+  Palette expand(palette.data(), 64);
+  FrameBuffer rgb24(width, height, PixelFormat::Rgb24);
+  FrameBuffer rgb565(width, height, PixelFormat::Rgb565);
+  FrameBuffer rgba32(width, height, PixelFormat::Rgba32);
+  expand.ConvertToRgb24(rgb24.GetData(), frame.data(), width * height);
+  expand.ConvertToRgb565((uint16_t*)rgb565.GetData(), frame.data(), width * height);
+  expand.ConvertToRgba32(rgba32.GetData(), frame.data(), width * height);
+
+  for (FrameBuffer* pBuffer : {&rgb24, &rgb565, &rgba32})
+  {
+    std::vector<uint8_t> indexed(width * height, 0xcd);
+    quantizer.Convert(FrameView(indexed.data(), width, height, PixelFormat::Indexed), pBuffer->GetView());
+    Test::Check(indexed == frame, "indexed frames survive the round trip");
+  }
+
+  // Views with a stride, only the visible part is written.
+  std::vector<uint8_t> wide(width * 2 * height, 0xcd);
+  quantizer.Convert(FrameView(wide.data(), width, height, PixelFormat::Indexed, width * 2), rgb24.GetView());
+  bool strided = true;
+  for (int y = 0; y < height; y++)
+  {
+    if (memcmp(&wide[y * width * 2], &frame[y * width], width) != 0 || wide[y * width * 2 + width] != 0xcd)
+      strided = false;
+  }
+  Test::Check(strided, "strided views");
+
+  // Changing the palette invalidates the table, setting the same one again keeps it.
+  std::vector<uint8_t> inverted(palette);
+  for (uint8_t& value : inverted) value = (uint8_t)~value;
+  for (int pass = 0; pass < 2; pass++)
+  {
+    quantizer.Set(inverted.data(), 64);
+    bool same = true;
+    for (int color = 0; color < 65536; color++)
+    {
+      if (quantizer.GetIndex((uint16_t)color) != Nearest(inverted, (uint16_t)color)) same = false;
+    }
+    Test::Check(same, pass == 0 ? "a new palette rebuilds the table" : "the same palette keeps the table");
+  }
+
+  quantizer.Set(nullptr, 0);
+  Test::Check(quantizer.GetIndex(0x1234) == 0, "no palette maps to 0");
+
+  return Test::Report();
+}
@@ -0,0 +1,78 @@
+// Round trips indexed frames through Helper::Split() and Helper::Join() for every plane count. The result has to be
+// the input with the bits above bitlen cleared, at the standard sizes and at widths whose group counts leave tails for
+// each narrower kernel loop.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+bool RoundTrip(int width, int height, int bitlen, const uint8_t* pFrame)
+{
+  size_t pixels = (size_t)width * height;
+  std::vector<uint8_t> frame(pFrame, pFrame + pixels);
+  std::vector<uint8_t> planes(pixels / 8 * bitlen, 0xcd);
+  std::vector<uint8_t> joined(pixels, 0xcd);
+  Helper::Split(planes.data(), (uint16_t)width, (uint16_t)height, (uint8_t)bitlen, frame.data());
+  Helper::Join(joined.data(), (uint16_t)width, (uint16_t)height, (uint8_t)bitlen, planes.data());
+
+  uint8_t mask = bitlen >= 8 ? 0xff : (uint8_t)((1 << bitlen) - 1);
+  for (size_t i = 0; i < pixels; i++)
+  {
+    if (joined[i] != (frame[i] & mask)) return false;
+  }
+  // Planes above the 8 an indexed pixel can hold come out empty.
+  for (size_t i = pixels; i < planes.size(); i++)
+  {
+    if (planes[i] != 0) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main()
+{
+  if (!Test::HasRequestedKernels()) return Test::Skipped;
+
+  // 2, 4, 6 and 8 planes have their own kernels, the others take the generic one.
+  const int bitlens[] = {1, 2, 3, 4, 5, 6, 7, 8, 10};
+
+  for (const auto& size : Test::Sizes)
+  {
+    for (const Test::CorpusFrame& frame : Test::MakeCorpus(size[0], size[1]))
+    {
+      for (int bitlen : bitlens)
+      {
+        char what[96];
+        snprintf(what, sizeof(what), "%dx%d %s, %d planes", size[0], size[1], frame.name.c_str(), bitlen);
+        Test::Check(RoundTrip(size[0], size[1], bitlen, frame.Get(1)), what);
+      }
+    }
+  }
+
+  // A group is 8 pixels. 1, 3, 5 and 7 groups per row, on 1 and 3 rows, leave every combination of tails after the 4
+  // group AVX2 loop for the 2 group SSE2 or NEON loop and the single group SWAR loop.
+  const int sizes[][2] = {{8, 1}, {24, 1}, {40, 1}, {56, 1}, {8, 3}, {24, 3}, {40, 3}, {56, 3}};
+  uint64_t state = 29;
+  for (const auto& size : sizes)
+  {
+    std::vector<uint8_t> frame((size_t)size[0] * size[1]);
+    for (uint8_t& pixel : frame) pixel = (uint8_t)Test::SplitMix64(state);
+    for (int bitlen : bitlens)
+    {
+      char what[64];
+      snprintf(what, sizeof(what), "%dx%d, %d planes", size[0], size[1], bitlen);
+      Test::Check(RoundTrip(size[0], size[1], bitlen, frame.data()), what);
+    }
+  }
+
+  return Test::Report();
+}
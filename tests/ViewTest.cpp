@@ -0,0 +1,152 @@
+// Runs the FrameView overloads of Helper on views inside larger frames and checks that they produce the same pixels as
+// on packed frames, read nothing but the visible part of the source and write nothing but the visible part of dest.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Check.h"
+#include "Corpus.h"
+#include "FrameUtil.h"
+
+using namespace FrameUtil;
+
+namespace
+{
+
+const uint8_t Border = 0xcd;
+const PixelFormat Formats[] = {PixelFormat::Indexed, PixelFormat::Rgb565, PixelFormat::Rgb24, PixelFormat::Rgba32};
+
+// A frame placed at 3, 2 inside a larger one, with 5 extra columns and 3 extra rows of border around it.
+struct Embedded
+{
+  std::vector<uint8_t> data;
+  FrameView outer;
+  FrameView view;
+
+  Embedded(int width, int height, PixelFormat format)
+      : data((size_t)(width + 5) * (height + 3) * FrameView::GetPixelBytes(format), Border),
+        outer(data.data(), width + 5, height + 3, format),
+        view(outer.Crop(3, 2, width, height))
+  {
+  }
+
+  // Every byte outside the view still holds the border.
+  bool IsBorderUntouched() const
+  {
+    int bytes = view.GetPixelBytes();
+    for (int y = 0; y < outer.GetHeight(); y++)
+    {
+      const uint8_t* pRow = outer.GetRow(y);
+      for (int x = 0; x < outer.GetWidth() * bytes; x++)
+      {
+        bool inside = y >= 2 && y < 2 + view.GetHeight() && x >= 3 * bytes && x < (3 + view.GetWidth()) * bytes;
+        if (!inside && pRow[x] != Border) return false;
+      }
+    }
+    return true;
+  }
+};
+
+bool IsSame(const FrameView& view, FrameBuffer& packed)
+{
+  int rowBytes = view.GetWidth() * view.GetPixelBytes();
+  for (int y = 0; y < view.GetHeight(); y++)
+  {
+    if (memcmp(view.GetRow(y), &packed.GetData()[(size_t)y * rowBytes], rowBytes) != 0) return false;
+  }
+  return true;
+}
+
+// A random source, packed and inside a larger frame. Indices stay below 16 so they work with a 16 color palette.
+struct Source
+{
+  FrameBuffer packed;
+  Embedded embedded;
+
+  Source(int width, int height, PixelFormat format, uint64_t& state)
+      : packed(width, height, format), embedded(width, height, format)
+  {
+    for (size_t i = 0; i < packed.GetSize(); i++)
+    {
+      uint8_t value = (uint8_t)Test::SplitMix64(state);
+      packed.GetData()[i] = format == PixelFormat::Indexed ? value % 16 : value;
+    }
+    Helper::Copy(embedded.view, packed.GetView());
+  }
+};
+
+// Runs op(dest, src) on packed frames and on embedded ones and compares the results.
+template <typename Op>
+bool Matches(Source& source, int destWidth, int destHeight, PixelFormat destFormat, Op op)
+{
+  FrameBuffer packed(destWidth, destHeight, destFormat);
+  memset(packed.GetData(), Border, packed.GetSize());
+  op(packed.GetView(), source.packed.GetView());
+
+  Embedded dest(destWidth, destHeight, destFormat);
+  op(dest.view, source.embedded.view);
+  return IsSame(dest.view, packed) && dest.IsBorderUntouched() && source.embedded.IsBorderUntouched();
+}
+
+// Picks the FrameView overload of the Helper function passed by name.
+bool Matches(Source& source, int destWidth, int destHeight, PixelFormat destFormat,
+             void (*op)(const FrameView& dest, const FrameView& src))
+{
+  return Matches<decltype(op)>(source, destWidth, destHeight, destFormat, op);
+}
+
+}  // namespace
+
+int main()
+{
+  uint64_t state = 23;
+
+  for (PixelFormat format : Formats)
+  {
+    int bytes = FrameView::GetPixelBytes(format);
+    char what[64];
+    Source source(128, 32, format, state);
+
+    snprintf(what, sizeof(what), "Copy, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 128, 32, format, Helper::Copy), what);
+    snprintf(what, sizeof(what), "Center into a larger frame, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 192, 64, format, Helper::Center), what);
+    snprintf(what, sizeof(what), "Center into a smaller frame, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 100, 20, format, Helper::Center), what);
+    snprintf(what, sizeof(what), "ScaleUp, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 256, 64, format, Helper::ScaleUp), what);
+    snprintf(what, sizeof(what), "ScaleDown, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 64, 16, format, Helper::ScaleDown), what);
+    snprintf(what, sizeof(what), "ScaleDownPUP, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 64, 16, format, Helper::ScaleDownPUP), what);
+    snprintf(what, sizeof(what), "Clear, %d bytes per pixel", bytes);
+    Test::Check(Matches(source, 128, 32, format, [](const FrameView& dest, const FrameView&) { dest.Clear(); }), what);
+  }
+
+  Source indexed(128, 32, PixelFormat::Indexed, state);
+  uint8_t palette[16 * 3];
+  for (uint8_t& value : palette) value = (uint8_t)Test::SplitMix64(state);
+  Test::Check(Matches(indexed, 128, 32, PixelFormat::Rgb24, [&](const FrameView& dest, const FrameView& src)
+                      { Helper::ConvertToRgb24(dest, src, palette); }),
+              "ConvertToRgb24");
+
+  // Split reads the view, Join writes it, in between the planes have to be the same as for the packed frame.
+  for (uint8_t bitlen : {2, 4, 8})
+  {
+    std::vector<uint8_t> packedPlanes(128 * 32 / 8 * bitlen);
+    std::vector<uint8_t> planes(packedPlanes.size());
+    Helper::Split(packedPlanes.data(), bitlen, indexed.packed.GetView());
+    Helper::Split(planes.data(), bitlen, indexed.embedded.view);
+    char what[64];
+    snprintf(what, sizeof(what), "Split, %d planes", bitlen);
+    Test::Check(planes == packedPlanes && indexed.embedded.IsBorderUntouched(), what);
+
+    snprintf(what, sizeof(what), "Join, %d planes", bitlen);
+    Test::Check(Matches(indexed, 128, 32, PixelFormat::Indexed, [&](const FrameView& dest, const FrameView&)
+                        { Helper::Join(dest, bitlen, planes.data()); }),
+                what);
+  }
+
+  return Test::Report();
+}